@@ -1,74 +1,17 @@
 #include <gtk/gtk.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define FILE_NAME "student.txt"
-#define MAX_STUDENTS 2000
-
-typedef struct {
-    int roll;
-    char name[50];
-    char section[10];
-    float marks;
-    char grade[6];
-} Student;
-
-/* ---------------- Backend utilities ---------------- */
-
-void calc_grade_from_marks(Student *s) {
-    if (s->marks >= 90) strcpy(s->grade, "A+");
-    else if (s->marks >= 80) strcpy(s->grade, "A");
-    else if (s->marks >= 70) strcpy(s->grade, "B+");
-    else if (s->marks >= 60) strcpy(s->grade, "B");
-    else if (s->marks >= 50) strcpy(s->grade, "C");
-    else strcpy(s->grade, "F");
-}
-
-int load_students(Student arr[]) {
-    FILE *fp = fopen(FILE_NAME, "rb");
-    if (!fp) return 0;
-    int cnt = 0;
-    while (cnt < MAX_STUDENTS && fread(&arr[cnt], sizeof(Student), 1, fp) == 1) cnt++;
-    fclose(fp);
-    return cnt;
-}
-
-void save_all_students(Student arr[], int n) {
-    FILE *fp = fopen(FILE_NAME, "wb");
-    if (!fp) {
-        fprintf(stderr, "Error: cannot write to %s\n", FILE_NAME);
-        return;
-    }
-    fwrite(arr, sizeof(Student), n, fp);
-    fclose(fp);
-}
-
-void append_student(const Student *s) {
-    FILE *fp = fopen(FILE_NAME, "ab");
-    if (!fp) {
-        fp = fopen(FILE_NAME, "wb");
-        if (!fp) { fprintf(stderr, "Error: cannot open file for writing\n"); return; }
-    }
-    fwrite(s, sizeof(Student), 1, fp);
-    fclose(fp);
-}
-
-/* comparators */
-static int cmp_roll_asc(const void *a, const void *b) {
-    const Student *A = a, *B = b;
-    return (A->roll - B->roll);
-}
-static int cmp_marks_desc(const void *a, const void *b) {
-    const Student *A = a, *B = b;
-    if (A->marks < B->marks) return 1;
-    if (A->marks > B->marks) return -1;
-    return 0;
-}
+#include "store/student_store.h"
 
 /* ---------------- GTK helpers ---------------- */
 
-enum { COL_ROLL, COL_NAME, COL_SECTION, COL_MARKS, COL_GRADE, N_COLUMNS };
+/* List rows hold only the roll (for sorting) and an index into the window's
+ * copy of the records; the other cells are rendered straight from it. */
+enum { COL_ROLL, COL_INDEX, N_COLUMNS };
+enum { FIELD_NAME, FIELD_SECTION, FIELD_MARKS, FIELD_GRADE };
 
 static void show_message(GtkWindow *parent, const char *title, const char *msg) {
     GtkWidget *d = gtk_message_dialog_new(parent,
@@ -88,7 +31,106 @@ static void show_error(GtkWindow *parent, const char *title, const char *msg) {
     gtk_widget_destroy(d);
 }
 
-static void show_students_list_window(GtkWindow *parent, const char *title, Student arr[], int n) {
+static const char *save_error_message(int result) {
+    if (result == STORE_CONFLICT) return "Records were changed by another user. Please try again.";
+    return "Could not write the records file.";
+}
+
+/* ---------------- Roster cache ----------------
+ * The last roster read or written, served again while the file's generation
+ * is unchanged. A worker fills it at startup while the window is being
+ * realized, so the first request usually answers from memory. roster_lock
+ * also makes concurrent misses share one load. */
+
+static struct {
+    Student arr[MAX_STUDENTS];
+    int n;
+    unsigned long long generation;
+    gboolean valid;
+} roster;
+static GMutex roster_lock;
+static unsigned long long launch_t0; /* for the first_query metric */
+static gint first_answered = 0;
+
+static void note_first_answer(void) {
+    if (g_atomic_int_compare_and_exchange(&first_answered, 0, 1)) metrics_end(M_FIRST_QUERY, launch_t0, 0);
+}
+
+/* Caller holds roster_lock. */
+static void roster_refresh(void) {
+    unsigned long long gen = store_generation();
+    if (roster.valid && roster.generation == gen) return;
+    roster.n = load_students(roster.arr);
+    roster.generation = loaded_generation;
+    roster.valid = TRUE;
+}
+
+/* Drop-in for load_students: same result, from the cache when it is current. */
+static int load_roster(Student arr[]) {
+    g_mutex_lock(&roster_lock);
+    roster_refresh();
+    int n = roster.n;
+    memcpy(arr, roster.arr, sizeof(Student) * n);
+    loaded_generation = roster.generation;
+    g_mutex_unlock(&roster_lock);
+    note_first_answer();
+    return n;
+}
+
+static void roster_remember(const Student arr[], int n, unsigned long long generation) {
+    g_mutex_lock(&roster_lock);
+    memcpy(roster.arr, arr, sizeof(Student) * n);
+    roster.n = n;
+    roster.generation = generation;
+    roster.valid = TRUE;
+    g_mutex_unlock(&roster_lock);
+}
+
+static void prefetch_thread(GTask *task, gpointer source, gpointer task_data, GCancellable *cancel) {
+    warm_store();
+    g_mutex_lock(&roster_lock);
+    roster_refresh();
+    g_mutex_unlock(&roster_lock);
+    g_task_return_boolean(task, TRUE);
+}
+
+static void start_prefetch(void) {
+    GTask *task = g_task_new(NULL, NULL, NULL, NULL);
+    g_task_run_in_thread(task, prefetch_thread);
+    g_object_unref(task);
+}
+
+typedef struct PagedView PagedView;
+static const Student *paged_view_row(PagedView *v, int index);
+
+static void render_student_cell(GtkTreeViewColumn *col, GtkCellRenderer *cell,
+                                GtkTreeModel *model, GtkTreeIter *iter, gpointer field) {
+    PagedView *v = g_object_get_data(G_OBJECT(model), "view");
+    const Student *rows = g_object_get_data(G_OBJECT(model), "rows");
+    int i;
+    gtk_tree_model_get(model, iter, COL_INDEX, &i, -1);
+    const Student *s = v ? paged_view_row(v, i) : &rows[i];
+    char buf[32];
+    if (!s) { g_object_set(cell, "text", "", NULL); return; }
+    const char *text = buf;
+    switch (GPOINTER_TO_INT(field)) {
+    case FIELD_NAME: text = s->name; break;
+    case FIELD_SECTION: text = s->section; break;
+    case FIELD_MARKS: snprintf(buf, sizeof(buf), "%.2f", s->marks); break;
+    default: text = s->grade; break;
+    }
+    g_object_set(cell, "text", text, NULL);
+}
+
+static void add_student_column(GtkWidget *tree, const char *title, int field) {
+    GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
+    GtkTreeViewColumn *column = gtk_tree_view_column_new_with_attributes(title, renderer, NULL);
+    gtk_tree_view_column_set_cell_data_func(column, renderer, render_student_cell, GINT_TO_POINTER(field), NULL);
+    gtk_tree_view_append_column(GTK_TREE_VIEW(tree), column);
+}
+
+/* Builds a list window over store; returns the scrolled window. */
+static GtkWidget *students_list_window_new(GtkWindow *parent, const char *title, GtkListStore *store, gboolean sortable) {
     GtkWidget *win = gtk_window_new(GTK_WINDOW_TOPLEVEL);
     gtk_window_set_transient_for(GTK_WINDOW(win), parent);
     gtk_window_set_default_size(GTK_WINDOW(win), 720, 420);
@@ -97,50 +139,318 @@ static void show_students_list_window(GtkWindow *parent, const char *title, Stud
     GtkWidget *scrolled = gtk_scrolled_window_new(NULL, NULL);
     gtk_container_add(GTK_CONTAINER(win), scrolled);
 
-    GtkListStore *store = gtk_list_store_new(N_COLUMNS,
-        G_TYPE_INT, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_DOUBLE, G_TYPE_STRING);
+    GtkWidget *tree = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
 
-    GtkTreeIter iter;
-    for (int i = 0; i < n; ++i) {
-        gtk_list_store_append(store, &iter);
-        gtk_list_store_set(store, &iter,
-            COL_ROLL, arr[i].roll,
-            COL_NAME, arr[i].name,
-            COL_SECTION, arr[i].section,
-            COL_MARKS, (gdouble)arr[i].marks,
-            COL_GRADE, arr[i].grade,
-            -1);
+    GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
+    GtkTreeViewColumn *column = gtk_tree_view_column_new_with_attributes("Roll", renderer, "text", COL_ROLL, NULL);
+    if (sortable) gtk_tree_view_column_set_sort_column_id(column, COL_ROLL);
+    gtk_tree_view_append_column(GTK_TREE_VIEW(tree), column);
+
+    add_student_column(tree, "Name", FIELD_NAME);
+    add_student_column(tree, "Section", FIELD_SECTION);
+    add_student_column(tree, "Marks", FIELD_MARKS);
+    add_student_column(tree, "Grade", FIELD_GRADE);
+
+    gtk_container_add(GTK_CONTAINER(scrolled), tree);
+    gtk_widget_show_all(win);
+    return scrolled;
+}
+
+static void show_students_list_window(GtkWindow *parent, const char *title, Student arr[], int n) {
+    GtkListStore *store = gtk_list_store_new(N_COLUMNS, G_TYPE_INT, G_TYPE_INT);
+
+    /* The records live in one arena owned by the model and go with it. */
+    unsigned long long t0 = metrics_start();
+    Arena *arena = arena_new(sizeof(Student) * (n > 0 ? n : 1));
+    Student *rows = arena ? arena_alloc(arena, sizeof(Student) * n) : NULL;
+    if (!rows) {
+        arena_free(arena);
+        g_object_unref(store);
+        show_error(parent, "Error", "Out of memory.");
+        return;
     }
+    memcpy(rows, arr, sizeof(Student) * n);
+    g_object_set_data(G_OBJECT(store), "rows", rows);
+    g_object_set_data_full(G_OBJECT(store), "arena", arena, (GDestroyNotify)arena_free);
+    GtkTreeIter iter;
+    for (int i = 0; i < n; ++i)
+        gtk_list_store_insert_with_values(store, &iter, -1, COL_ROLL, rows[i].roll, COL_INDEX, i, -1);
+    metrics_end(M_LIST_POPULATE, t0, 0);
 
-    GtkWidget *tree = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
+    students_list_window_new(parent, title, store, TRUE);
     g_object_unref(store);
+}
 
-    GtkCellRenderer *renderer;
-    GtkTreeViewColumn *column;
+/* ---------------- Background store calls ----------------
+ * Every store call a handler makes (loads, saves, inserts, rank lookups and
+ * cache checks) runs on GLib's worker pool through GTask, so the UI thread
+ * never waits on the disk or on a worker's store lock. A job carries its
+ * records and the handler's payload in one arena; work runs on the worker
+ * and done back in the main loop. */
 
-    renderer = gtk_cell_renderer_text_new();
-    column = gtk_tree_view_column_new_with_attributes("Roll", renderer, "text", COL_ROLL, NULL);
-    gtk_tree_view_column_set_sort_column_id(column, COL_ROLL);
-    gtk_tree_view_append_column(GTK_TREE_VIEW(tree), column);
+typedef struct IoJob IoJob;
+typedef void (*IoFunc)(IoJob *job);
 
-    renderer = gtk_cell_renderer_text_new();
-    column = gtk_tree_view_column_new_with_attributes("Name", renderer, "text", COL_NAME, NULL);
-    gtk_tree_view_append_column(GTK_TREE_VIEW(tree), column);
+struct IoJob {
+    Arena *arena; /* holds the job, its records and its payload */
+    GtkWindow *parent;
+    Student *arr;
+    int n;
+    int result;
+    unsigned long long generation; /* loaded_generation is per thread */
+    IoFunc work;
+    IoFunc done;
+    gpointer data; /* the handler's payload, zeroed */
+};
+
+static void io_job_free(gpointer p) {
+    IoJob *job = p;
+    g_object_unref(job->parent);
+    arena_free(job->arena);
+}
 
-    renderer = gtk_cell_renderer_text_new();
-    column = gtk_tree_view_column_new_with_attributes("Section", renderer, "text", COL_SECTION, NULL);
-    gtk_tree_view_append_column(GTK_TREE_VIEW(tree), column);
+/* One allocation per job: the job, room for n records and a payload.
+ * Returns NULL, having told the user, when out of memory. */
+static IoJob *io_job_new(GtkWindow *parent, int n, gsize payload) {
+    Arena *arena = arena_new(sizeof(IoJob) + sizeof(Student) * n + payload + 64);
+    IoJob *job = arena ? arena_alloc(arena, sizeof(IoJob)) : NULL;
+    Student *arr = job ? arena_alloc(arena, sizeof(Student) * n) : NULL;
+    gpointer data = arr && payload ? arena_alloc(arena, payload) : NULL;
+    if (!arr || (payload && !data)) {
+        arena_free(arena);
+        show_error(parent, "Error", "Out of memory.");
+        return NULL;
+    }
+    memset(job, 0, sizeof(*job));
+    job->arena = arena;
+    job->arr = arr;
+    if (payload) job->data = memset(data, 0, payload);
+    job->parent = g_object_ref(parent);
+    job->generation = loaded_generation;
+    return job;
+}
 
-    renderer = gtk_cell_renderer_text_new();
-    column = gtk_tree_view_column_new_with_attributes("Marks", renderer, "text", COL_MARKS, NULL);
-    gtk_tree_view_append_column(GTK_TREE_VIEW(tree), column);
+static void io_thread(GTask *task, gpointer source, gpointer task_data, GCancellable *cancel) {
+    IoJob *job = task_data;
+    loaded_generation = job->generation;
+    job->work(job);
+    job->generation = loaded_generation;
+    g_task_return_boolean(task, TRUE);
+}
 
-    renderer = gtk_cell_renderer_text_new();
-    column = gtk_tree_view_column_new_with_attributes("Grade", renderer, "text", COL_GRADE, NULL);
-    gtk_tree_view_append_column(GTK_TREE_VIEW(tree), column);
+static void io_ready(GObject *source, GAsyncResult *res, gpointer user_data) {
+    IoJob *job = g_task_get_task_data(G_TASK(res));
+    loaded_generation = job->generation;
+    job->done(job);
+}
 
-    gtk_container_add(GTK_CONTAINER(scrolled), tree);
-    gtk_widget_show_all(win);
+static void io_job_run(IoJob *job, IoFunc work, IoFunc done) {
+    job->work = work;
+    job->done = done;
+    GTask *task = g_task_new(NULL, NULL, io_ready, NULL);
+    g_task_set_task_data(task, job, io_job_free);
+    g_task_run_in_thread(task, io_thread);
+    g_object_unref(task);
+}
+
+static void load_work(IoJob *job) {
+    job->n = load_roster(job->arr);
+}
+
+static void save_work(IoJob *job) {
+    job->result = save_all_students(job->arr, job->n);
+    if (job->result == STORE_OK) roster_remember(job->arr, job->n, loaded_generation);
+}
+
+/* A cached report's records if the roster is unchanged since it was
+ * computed, so repeated reports skip the load and the sort; -1 otherwise.
+ * Worker threads only. */
+static int cached_students(const char *key, Student arr[]) {
+    long got = cache_get(key, store_generation(), arr, sizeof(Student) * MAX_STUDENTS);
+    return got < 0 ? -1 : (int)(got / sizeof(Student));
+}
+
+/* ---------------- Paged list ----------------
+ * Rows are added a page at a time as the user nears the bottom. Pages are
+ * fetched by a worker through the window's PagedReader, one fetch at a
+ * time, and kept in a small cache on the main thread; cells are drawn only
+ * from that cache, so scrolling never waits on the store lock. A cell whose
+ * page is not cached yet draws blank and asks for it. */
+
+#define PAGED_VIEW_PAGES PAGE_CACHE_PAGES
+
+typedef struct {
+    int n;
+    Student recs[PAGE_RECORDS];
+} PageRows;
+
+struct PagedView {
+    PagedReader *pr;     /* only the fetch in flight touches it */
+    GHashTable *pages;   /* page -> PageRows */
+    GtkListStore *store; /* owns the view */
+    GtkWindow *win;      /* NULL until shown, and again once closed */
+    const char *title;
+    unsigned long long generation;
+    int count, shown;
+    gboolean fetching;
+    int wanted;          /* page to fetch once the current fetch is done, -1 if none */
+};
+
+typedef struct {
+    PagedView *view;
+    int first, npages;   /* pages asked for */
+    int n, count;        /* records fetched, and on file */
+    unsigned long long generation;
+    Student recs[2 * PAGE_RECORDS];
+} PageFetch;
+
+static void paged_view_free(gpointer p) {
+    PagedView *v = p;
+    if (v->win) g_object_remove_weak_pointer(G_OBJECT(v->win), (gpointer *)&v->win);
+    pager_close(v->pr);
+    g_hash_table_destroy(v->pages);
+    g_free(v);
+}
+
+static void page_fetch_work(IoJob *job) {
+    PageFetch *f = job->data;
+    PagedView *v = f->view;
+    if (!v->pr) v->pr = pager_open(0);
+    if (!v->pr) { job->result = STORE_ERROR; return; }
+    const Student *s;
+    for (int i = f->first * PAGE_RECORDS; f->n < f->npages * PAGE_RECORDS && (s = pager_get(v->pr, i)); ++i)
+        f->recs[f->n++] = *s;
+    f->count = pager_count(v->pr);
+    f->generation = pager_generation(v->pr);
+    job->result = STORE_OK;
+}
+
+static void page_fetch_done(IoJob *job);
+
+static void paged_view_fetch(PagedView *v, GtkWindow *parent, int first, int npages) {
+    IoJob *job = io_job_new(parent, 0, sizeof(PageFetch));
+    if (!job) return;
+    PageFetch *f = job->data;
+    f->view = v;
+    f->first = first;
+    f->npages = npages;
+    v->fetching = TRUE;
+    g_object_ref(v->store); /* the view lives until the fetch is done */
+    io_job_run(job, page_fetch_work, page_fetch_done);
+}
+
+static void paged_view_want(PagedView *v, int page) {
+    if (!v->win || page * PAGE_RECORDS >= v->count || g_hash_table_contains(v->pages, GINT_TO_POINTER(page))) return;
+    if (v->fetching) v->wanted = page;
+    else paged_view_fetch(v, v->win, page, 1);
+}
+
+static const Student *paged_view_row(PagedView *v, int index) {
+    const PageRows *p = g_hash_table_lookup(v->pages, GINT_TO_POINTER(index / PAGE_RECORDS));
+    if (p && index % PAGE_RECORDS < p->n) return &p->recs[index % PAGE_RECORDS];
+    if (!p) paged_view_want(v, index / PAGE_RECORDS);
+    return NULL;
+}
+
+/* Caches page, evicting the cached page farthest from it when full. */
+static void paged_view_put(PagedView *v, int page, const Student *recs, int n) {
+    if (g_hash_table_size(v->pages) >= PAGED_VIEW_PAGES) {
+        GHashTableIter it;
+        gpointer key;
+        int far = -1;
+        g_hash_table_iter_init(&it, v->pages);
+        while (g_hash_table_iter_next(&it, &key, NULL))
+            if (far < 0 || abs(GPOINTER_TO_INT(key) - page) > abs(far - page)) far = GPOINTER_TO_INT(key);
+        g_hash_table_remove(v->pages, GINT_TO_POINTER(far));
+    }
+    PageRows *p = g_new(PageRows, 1);
+    p->n = n;
+    memcpy(p->recs, recs, sizeof(Student) * n);
+    g_hash_table_replace(v->pages, GINT_TO_POINTER(page), p);
+}
+
+/* Adds the next page of rows if it is cached, asking for it otherwise. */
+static void append_page_rows(PagedView *v) {
+    if (v->shown >= v->count) return;
+    const PageRows *p = g_hash_table_lookup(v->pages, GINT_TO_POINTER(v->shown / PAGE_RECORDS));
+    if (!p) { paged_view_want(v, v->shown / PAGE_RECORDS); return; }
+    unsigned long long t0 = metrics_start();
+    GtkTreeIter iter;
+    for (int off = v->shown % PAGE_RECORDS; off < p->n && v->shown < v->count; ++off, ++v->shown)
+        gtk_list_store_insert_with_values(v->store, &iter, -1, COL_ROLL, p->recs[off].roll, COL_INDEX, v->shown, -1);
+    metrics_end(M_LIST_POPULATE, t0, 0);
+}
+
+/* Redraws the rows of a page that arrived after they were drawn blank. */
+static void paged_view_rows_changed(PagedView *v, int page, int n) {
+    GtkTreeModel *model = GTK_TREE_MODEL(v->store);
+    for (int i = page * PAGE_RECORDS; i < page * PAGE_RECORDS + n && i < v->shown; ++i) {
+        GtkTreeIter iter;
+        GtkTreePath *path = gtk_tree_path_new_from_indices(i, -1);
+        if (gtk_tree_model_get_iter(model, &iter, path)) gtk_tree_model_row_changed(model, path, &iter);
+        gtk_tree_path_free(path);
+    }
+}
+
+static void on_paged_list_scrolled(GtkAdjustment *adj, gpointer user_data) {
+    PagedView *v = g_object_get_data(G_OBJECT(user_data), "view");
+    gdouble left = gtk_adjustment_get_upper(adj) - gtk_adjustment_get_value(adj) - gtk_adjustment_get_page_size(adj);
+    if (v->shown < v->count && left < gtk_adjustment_get_page_size(adj)) append_page_rows(v);
+}
+
+static void paged_view_show(PagedView *v, GtkWindow *parent) {
+    if (v->count == 0) { show_message(parent, "No records", "No records found."); return; }
+    append_page_rows(v);
+    append_page_rows(v); /* enough to make the window scroll */
+    note_first_answer();
+
+    /* Sorting would need every row, so the roll column stays in file order. */
+    GtkWidget *scrolled = students_list_window_new(parent, v->title, v->store, FALSE);
+    v->win = GTK_WINDOW(gtk_widget_get_toplevel(scrolled));
+    g_object_add_weak_pointer(G_OBJECT(v->win), (gpointer *)&v->win);
+    GtkAdjustment *adj = gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(scrolled));
+    g_signal_connect_object(adj, "value-changed", G_CALLBACK(on_paged_list_scrolled), v->store, 0);
+    g_signal_connect_object(adj, "changed", G_CALLBACK(on_paged_list_scrolled), v->store, 0);
+}
+
+static void page_fetch_done(IoJob *job) {
+    PageFetch *f = job->data;
+    PagedView *v = f->view;
+    gboolean opening = v->count < 0;
+    v->fetching = FALSE;
+    if (job->result != STORE_OK) {
+        if (opening) show_error(job->parent, "Error", "Could not read the records file.");
+        g_object_unref(v->store);
+        return;
+    }
+    if (f->generation != v->generation) g_hash_table_remove_all(v->pages); /* a write moved records */
+    v->generation = f->generation;
+    v->count = f->count;
+    for (int k = 0; k * PAGE_RECORDS < f->n; ++k) {
+        int n = MIN(PAGE_RECORDS, f->n - k * PAGE_RECORDS);
+        paged_view_put(v, f->first + k, &f->recs[k * PAGE_RECORDS], n);
+        paged_view_rows_changed(v, f->first + k, n);
+    }
+    if (opening) paged_view_show(v, job->parent);
+    else if (v->win) on_paged_list_scrolled(gtk_scrolled_window_get_vadjustment(
+        GTK_SCROLLED_WINDOW(gtk_bin_get_child(GTK_BIN(v->win)))), v->store);
+    int page = v->wanted;
+    v->wanted = -1;
+    if (page >= 0) paged_view_want(v, page);
+    g_object_unref(v->store);
+}
+
+static void show_paged_students_window(GtkWindow *parent, const char *title) {
+    GtkListStore *store = gtk_list_store_new(N_COLUMNS, G_TYPE_INT, G_TYPE_INT);
+    PagedView *v = g_new0(PagedView, 1);
+    v->pages = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    v->store = store;
+    v->title = title;
+    v->count = -1; /* until the first fetch */
+    v->wanted = -1;
+    g_object_set_data_full(G_OBJECT(store), "view", v, paged_view_free);
+    paged_view_fetch(v, parent, 0, 2);
+    g_object_unref(store); /* the fetch holds it now */
 }
 
 /* ---------------- UI structs ---------------- */
@@ -163,8 +473,36 @@ typedef struct {
     GtkWindow *parent;
 } UpdateData;
 
+/* Form state lives in an arena tied to the form window, so it is freed
+ * however the window closes (Save, Cancel or the close button). Returns
+ * NULL, having told the user, when out of memory. */
+static gpointer form_state_new(GtkWidget *win, gsize size) {
+    Arena *arena = arena_new(size);
+    gpointer state = arena ? arena_alloc(arena, size) : NULL;
+    if (!state) {
+        arena_free(arena);
+        show_error(gtk_window_get_transient_for(GTK_WINDOW(win)), "Error", "Out of memory.");
+        return NULL;
+    }
+    g_object_set_data_full(G_OBJECT(win), "arena", arena, (GDestroyNotify)arena_free);
+    return state;
+}
+
 /* ---------------- Insert feature (with unique roll check) ---------------- */
 
+static void insert_work(IoJob *job) {
+    /* insert_student does the unique roll check under the write lock */
+    job->result = insert_student(&job->arr[0]);
+}
+
+static void insert_done(IoJob *job) {
+    gtk_widget_set_sensitive(GTK_WIDGET(job->parent), TRUE);
+    if (job->result == STORE_DUPLICATE) { show_error(job->parent, "Duplicate", "Roll number already exists."); return; }
+    if (job->result != STORE_OK) { show_error(job->parent, "Error", "Could not save the record."); return; }
+    show_message(job->parent, "Success", "Student inserted successfully.");
+    gtk_widget_destroy(GTK_WIDGET(job->parent));
+}
+
 static void on_insert_save_clicked(GtkButton *btn, gpointer user_data) {
     InsertData *d = (InsertData*)user_data;
     const char *sroll = gtk_entry_get_text(GTK_ENTRY(d->ent_roll));
@@ -178,26 +516,20 @@ static void on_insert_save_clicked(GtkButton *btn, gpointer user_data) {
     if (roll <= 0) { show_error(d->parent, "Input Error", "Roll must be a positive integer."); return; }
     if (smarks[0] == '\0') { show_error(d->parent, "Input Error", "Marks are required."); return; }
     float marks = atof(smarks);
-    if (marks < 0 || marks > 100) { show_error(d->parent, "Input Error", "Marks must be between 0 and 100."); return; }
-
-    /* unique roll check */
-    Student tmp[MAX_STUDENTS]; int n = load_students(tmp);
-    for (int i = 0; i < n; ++i) {
-        if (tmp[i].roll == roll) { show_error(d->parent, "Duplicate", "Roll number already exists."); return; }
-    }
-
-    Student s;
-    s.roll = roll;
-    strncpy(s.name, sname[0] ? sname : "Unknown", sizeof(s.name)-1); s.name[sizeof(s.name)-1] = 0;
-    strncpy(s.section, ssection[0] ? ssection : "-", sizeof(s.section)-1); s.section[sizeof(s.section)-1] = 0;
-    s.marks = marks;
-    if (sgrade[0] == '\0') calc_grade_from_marks(&s);
-    else { strncpy(s.grade, sgrade, sizeof(s.grade)-1); s.grade[sizeof(s.grade)-1] = 0; }
-
-    append_student(&s);
-    show_message(d->parent, "Success", "Student inserted successfully.");
-    gtk_widget_destroy(GTK_WIDGET(d->parent));
-    g_free(d);
+    if (!(marks >= 0 && marks <= 100)) { show_error(d->parent, "Input Error", "Marks must be between 0 and 100."); return; }
+
+    IoJob *job = io_job_new(d->parent, 1, 0);
+    if (!job) return;
+    Student *s = &job->arr[0];
+    s->roll = roll;
+    snprintf(s->name, sizeof(s->name), "%s", sname[0] ? sname : "Unknown");
+    snprintf(s->section, sizeof(s->section), "%s", ssection[0] ? ssection : "-");
+    s->marks = marks;
+    if (sgrade[0] == '\0') calc_grade_from_marks(s);
+    else snprintf(s->grade, sizeof(s->grade), "%s", sgrade);
+
+    gtk_widget_set_sensitive(GTK_WIDGET(d->parent), FALSE); /* until the insert is done */
+    io_job_run(job, insert_work, insert_done);
 }
 
 static void on_insert_clicked(GtkButton *b, gpointer user_data) {
@@ -245,11 +577,12 @@ static void on_insert_clicked(GtkButton *b, gpointer user_data) {
     gtk_grid_attach(GTK_GRID(grid), btn_save, 0, 5, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), btn_cancel, 1, 5, 1, 1);
 
-    InsertData *d = g_malloc(sizeof(InsertData));
+    InsertData *d = form_state_new(win, sizeof(InsertData));
+    if (!d) { gtk_widget_destroy(win); return; }
     d->ent_roll = ent_roll; d->ent_name = ent_name; d->ent_section = ent_section;
     d->ent_marks = ent_marks; d->ent_grade = ent_grade; d->parent = GTK_WINDOW(win);
 
-    g_signal_connect(btn_cancel, "clicked", G_CALLBACK(gtk_widget_destroy), win);
+    g_signal_connect_swapped(btn_cancel, "clicked", G_CALLBACK(gtk_widget_destroy), win);
     g_signal_connect(btn_save, "clicked", G_CALLBACK(on_insert_save_clicked), d);
 
     gtk_widget_show_all(win);
@@ -258,89 +591,120 @@ static void on_insert_clicked(GtkButton *b, gpointer user_data) {
 /* ---------------- Display all ---------------- */
 
 static void on_display_all_clicked(GtkButton *b, gpointer user_data) {
-    GtkWindow *parent = GTK_WINDOW(user_data);
-    Student arr[MAX_STUDENTS];
-    int n = load_students(arr);
-    if (n == 0) { show_message(parent, "No records", "No records found."); return; }
-    show_students_list_window(parent, "All Students", arr, n);
+    show_paged_students_window(GTK_WINDOW(user_data), "All Students");
 }
 
 /* ---------------- Search by roll ---------------- */
 
-static void on_search_by_roll_clicked(GtkButton *b, gpointer user_data) {
-    GtkWindow *parent = GTK_WINDOW(user_data);
-    GtkWidget *dialog = gtk_dialog_new_with_buttons("Search by Roll", parent,
+/* Asks for a roll number in a modal dialog. Returns it, or 0 if the user
+ * cancelled or typed something that is not a roll. */
+static int ask_roll(GtkWindow *parent, const char *title, const char *action, const char *prompt) {
+    GtkWidget *dialog = gtk_dialog_new_with_buttons(title, parent,
         GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
-        "Search", GTK_RESPONSE_OK, "Cancel", GTK_RESPONSE_CANCEL, NULL);
+        action, GTK_RESPONSE_OK, "Cancel", GTK_RESPONSE_CANCEL, NULL);
     GtkWidget *content = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
     GtkWidget *grid = gtk_grid_new();
     gtk_container_add(GTK_CONTAINER(content), grid);
     gtk_grid_set_row_spacing(GTK_GRID(grid), 6); gtk_grid_set_column_spacing(GTK_GRID(grid), 6);
-    GtkWidget *lbl = gtk_label_new("Enter Roll:");
+    GtkWidget *lbl = gtk_label_new(prompt);
     GtkWidget *ent = gtk_entry_new();
     gtk_grid_attach(GTK_GRID(grid), lbl, 0, 0, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), ent, 1, 0, 1, 1);
     gtk_widget_show_all(dialog);
-    gint resp = gtk_dialog_run(GTK_DIALOG(dialog));
-    if (resp == GTK_RESPONSE_OK) {
-        const char *sroll = gtk_entry_get_text(GTK_ENTRY(ent));
-        int roll = atoi(sroll);
-        if (roll <= 0) show_error(parent, "Input Error", "Invalid roll.");
-        else {
-            Student arr[MAX_STUDENTS]; int n = load_students(arr); int found = 0;
-            for (int i = 0; i < n; ++i) {
-                if (arr[i].roll == roll) { show_students_list_window(parent, "Search Result", &arr[i], 1); found = 1; break; }
-            }
-            if (!found) show_message(parent, "Not found", "Record not found.");
-        }
+    int roll = 0;
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+        roll = atoi(gtk_entry_get_text(GTK_ENTRY(ent)));
+        if (roll <= 0) { show_error(parent, "Input Error", "Invalid roll."); roll = 0; }
     }
     gtk_widget_destroy(dialog);
+    return roll;
+}
+
+/* Loads the roster in the background, then calls done with the roll in
+ * the job's payload. */
+static void load_for_roll(GtkWindow *parent, int roll, IoFunc done) {
+    IoJob *job = io_job_new(parent, MAX_STUDENTS, sizeof(int));
+    if (!job) return;
+    *(int *)job->data = roll;
+    io_job_run(job, load_work, done);
+}
+
+static void search_loaded(IoJob *job) {
+    int idx = find_by_roll(job->arr, job->n, *(int *)job->data);
+    if (idx == -1) show_message(job->parent, "Not found", "Record not found.");
+    else show_students_list_window(job->parent, "Search Result", &job->arr[idx], 1);
+}
+
+static void on_search_by_roll_clicked(GtkButton *b, gpointer user_data) {
+    GtkWindow *parent = GTK_WINDOW(user_data);
+    int roll = ask_roll(parent, "Search by Roll", "Search", "Enter Roll:");
+    if (roll) load_for_roll(parent, roll, search_loaded);
 }
 
 /* ---------------- Delete ---------------- */
 
+static void delete_saved(IoJob *job) {
+    if (job->result == STORE_OK) show_message(job->parent, "Deleted", "Record deleted successfully.");
+    else show_error(job->parent, "Error", save_error_message(job->result));
+}
+
+static void delete_loaded(IoJob *job) {
+    int roll = *(int *)job->data, n = job->n;
+    int idx = find_by_roll(job->arr, n, roll);
+    if (idx == -1) { show_message(job->parent, "Not found", "Record not found."); return; }
+    GtkWidget *confirm = gtk_message_dialog_new(job->parent,
+        GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+        GTK_MESSAGE_QUESTION, GTK_BUTTONS_YES_NO,
+        "Are you sure you want to delete roll %d?", roll);
+    gint r2 = gtk_dialog_run(GTK_DIALOG(confirm));
+    gtk_widget_destroy(confirm);
+    if (r2 != GTK_RESPONSE_YES) return;
+    IoJob *save = io_job_new(job->parent, n - 1, 0); /* takes the generation just loaded */
+    if (!save) return;
+    memcpy(save->arr, job->arr, sizeof(Student) * idx);
+    memcpy(save->arr + idx, job->arr + idx + 1, sizeof(Student) * (n - 1 - idx));
+    save->n = n - 1;
+    io_job_run(save, save_work, delete_saved);
+}
+
 static void on_delete_clicked(GtkButton *b, gpointer user_data) {
     GtkWindow *parent = GTK_WINDOW(user_data);
-    GtkWidget *dialog = gtk_dialog_new_with_buttons("Delete Student", parent,
-        GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
-        "Delete", GTK_RESPONSE_OK, "Cancel", GTK_RESPONSE_CANCEL, NULL);
-    GtkWidget *content = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
-    GtkWidget *grid = gtk_grid_new();
-    gtk_container_add(GTK_CONTAINER(content), grid);
-    gtk_grid_set_row_spacing(GTK_GRID(grid), 6); gtk_grid_set_column_spacing(GTK_GRID(grid), 6);
-    GtkWidget *lbl = gtk_label_new("Enter Roll to delete:");
-    GtkWidget *ent = gtk_entry_new();
-    gtk_grid_attach(GTK_GRID(grid), lbl, 0, 0, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), ent, 1, 0, 1, 1);
-    gtk_widget_show_all(dialog);
-    gint resp = gtk_dialog_run(GTK_DIALOG(dialog));
-    if (resp == GTK_RESPONSE_OK) {
-        int roll = atoi(gtk_entry_get_text(GTK_ENTRY(ent)));
-        if (roll <= 0) show_error(parent, "Input Error", "Invalid roll.");
-        else {
-            Student arr[MAX_STUDENTS]; int n = load_students(arr); int idx = -1;
-            for (int i = 0; i < n; ++i) if (arr[i].roll == roll) { idx = i; break; }
-            if (idx == -1) show_message(parent, "Not found", "Record not found.");
-            else {
-                GtkWidget *confirm = gtk_message_dialog_new(parent,
-                    GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
-                    GTK_MESSAGE_QUESTION, GTK_BUTTONS_YES_NO,
-                    "Are you sure you want to delete roll %d?", roll);
-                gint r2 = gtk_dialog_run(GTK_DIALOG(confirm));
-                gtk_widget_destroy(confirm);
-                if (r2 == GTK_RESPONSE_YES) {
-                    for (int i = idx; i < n - 1; ++i) arr[i] = arr[i+1];
-                    save_all_students(arr, n - 1);
-                    show_message(parent, "Deleted", "Record deleted successfully.");
-                }
-            }
-        }
-    }
-    gtk_widget_destroy(dialog);
+    int roll = ask_roll(parent, "Delete Student", "Delete", "Enter Roll to delete:");
+    if (roll) load_for_roll(parent, roll, delete_loaded);
 }
 
 /* ---------------- Update ---------------- */
 
+/* Blank name, section or grade leave the stored value (grade: recomputed). */
+typedef struct {
+    Student edit;
+    gboolean found;
+} UpdateJob;
+
+static void update_work(IoJob *job) {
+    UpdateJob *u = job->data;
+    job->n = load_roster(job->arr);
+    int idx = find_by_roll(job->arr, job->n, u->edit.roll);
+    if (idx == -1) return;
+    u->found = TRUE;
+    Student *s = &job->arr[idx];
+    if (u->edit.name[0] != '\0') memcpy(s->name, u->edit.name, sizeof(s->name));
+    if (u->edit.section[0] != '\0') memcpy(s->section, u->edit.section, sizeof(s->section));
+    s->marks = u->edit.marks;
+    if (u->edit.grade[0] == '\0') calc_grade_from_marks(s);
+    else memcpy(s->grade, u->edit.grade, sizeof(s->grade));
+    save_work(job);
+}
+
+static void update_saved(IoJob *job) {
+    UpdateJob *u = job->data;
+    gtk_widget_set_sensitive(GTK_WIDGET(job->parent), TRUE);
+    if (!u->found) { show_error(job->parent, "Not found", "Record not found when saving."); return; }
+    if (job->result != STORE_OK) { show_error(job->parent, "Error", save_error_message(job->result)); return; }
+    show_message(job->parent, "Success", "Record updated successfully.");
+    gtk_widget_destroy(GTK_WIDGET(job->parent));
+}
+
 static void on_update_save_clicked(GtkButton *btn, gpointer user_data) {
     UpdateData *d = (UpdateData*)user_data;
     const char *sroll = gtk_entry_get_text(GTK_ENTRY(d->ent_roll_readonly));
@@ -353,111 +717,112 @@ static void on_update_save_clicked(GtkButton *btn, gpointer user_data) {
     if (roll <= 0) { show_error(d->parent, "Input Error", "Invalid roll."); return; }
     if (smarks[0] == '\0') { show_error(d->parent, "Input Error", "Marks required."); return; }
     float marks = atof(smarks);
-    if (marks < 0 || marks > 100) { show_error(d->parent, "Input Error", "Marks must be 0-100."); return; }
+    if (!(marks >= 0 && marks <= 100)) { show_error(d->parent, "Input Error", "Marks must be 0-100."); return; }
+
+    /* The load, the edit and the save all happen on the worker. */
+    IoJob *job = io_job_new(d->parent, MAX_STUDENTS, sizeof(UpdateJob));
+    if (!job) return;
+    Student *e = &((UpdateJob *)job->data)->edit;
+    e->roll = roll;
+    snprintf(e->name, sizeof(e->name), "%s", sname);
+    snprintf(e->section, sizeof(e->section), "%s", ssection);
+    e->marks = marks;
+    snprintf(e->grade, sizeof(e->grade), "%s", sgrade);
+    gtk_widget_set_sensitive(GTK_WIDGET(d->parent), FALSE); /* until the save is done */
+    io_job_run(job, update_work, update_saved);
+}
 
-    Student arr[MAX_STUDENTS]; int n = load_students(arr); int idx = -1;
-    for (int i = 0; i < n; ++i) if (arr[i].roll == roll) { idx = i; break; }
-    if (idx == -1) { show_error(d->parent, "Not found", "Record not found when saving."); return; }
+static void show_update_window(GtkWindow *parent, const Student *s) {
+    GtkWidget *uwin = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_transient_for(GTK_WINDOW(uwin), parent);
+    gtk_window_set_title(GTK_WINDOW(uwin), "Update Student");
+    gtk_window_set_default_size(GTK_WINDOW(uwin), 420, 260);
+    GtkWidget *ugrid = gtk_grid_new();
+    gtk_container_add(GTK_CONTAINER(uwin), ugrid);
+    gtk_grid_set_row_spacing(GTK_GRID(ugrid), 6); gtk_grid_set_column_spacing(GTK_GRID(ugrid), 8);
+    gtk_container_set_border_width(GTK_CONTAINER(ugrid), 10);
+
+    GtkWidget *lbl_rollr = gtk_label_new("Roll (readonly):");
+    GtkWidget *ent_rollr = gtk_entry_new();
+    char tmp[32]; snprintf(tmp, sizeof(tmp), "%d", s->roll);
+    gtk_entry_set_text(GTK_ENTRY(ent_rollr), tmp);
+    gtk_editable_set_editable(GTK_EDITABLE(ent_rollr), FALSE);
 
-    if (sname[0] != '\0') strncpy(arr[idx].name, sname, sizeof(arr[idx].name)-1);
-    if (ssection[0] != '\0') strncpy(arr[idx].section, ssection, sizeof(arr[idx].section)-1);
-    arr[idx].marks = marks;
-    if (sgrade[0] == '\0') calc_grade_from_marks(&arr[idx]);
-    else { strncpy(arr[idx].grade, sgrade, sizeof(arr[idx].grade)-1); arr[idx].grade[sizeof(arr[idx].grade)-1] = 0; }
+    GtkWidget *lbl_name = gtk_label_new("Name:");
+    GtkWidget *ent_name = gtk_entry_new();
+    gtk_entry_set_text(GTK_ENTRY(ent_name), s->name);
 
-    save_all_students(arr, n);
-    show_message(d->parent, "Success", "Record updated successfully.");
-    gtk_widget_destroy(GTK_WIDGET(d->parent));
-    g_free(d);
+    GtkWidget *lbl_section = gtk_label_new("Section:");
+    GtkWidget *ent_section = gtk_entry_new();
+    gtk_entry_set_text(GTK_ENTRY(ent_section), s->section);
+
+    GtkWidget *lbl_marks = gtk_label_new("Marks (0-100):");
+    GtkWidget *ent_marks = gtk_entry_new();
+    char tmpm[32]; snprintf(tmpm, sizeof(tmpm), "%.2f", s->marks);
+    gtk_entry_set_text(GTK_ENTRY(ent_marks), tmpm);
+
+    GtkWidget *lbl_grade = gtk_label_new("Grade (leave blank to auto-calc):");
+    GtkWidget *ent_grade = gtk_entry_new();
+    gtk_entry_set_text(GTK_ENTRY(ent_grade), s->grade);
+
+    GtkWidget *btn_save = gtk_button_new_with_label("Save");
+    GtkWidget *btn_cancel = gtk_button_new_with_label("Cancel");
+
+    gtk_grid_attach(GTK_GRID(ugrid), lbl_rollr, 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(ugrid), ent_rollr, 1, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(ugrid), lbl_name, 0, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(ugrid), ent_name, 1, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(ugrid), lbl_section, 0, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(ugrid), ent_section, 1, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(ugrid), lbl_marks, 0, 3, 1, 1);
+    gtk_grid_attach(GTK_GRID(ugrid), ent_marks, 1, 3, 1, 1);
+    gtk_grid_attach(GTK_GRID(ugrid), lbl_grade, 0, 4, 1, 1);
+    gtk_grid_attach(GTK_GRID(ugrid), ent_grade, 1, 4, 1, 1);
+    gtk_grid_attach(GTK_GRID(ugrid), btn_save, 0, 5, 1, 1);
+    gtk_grid_attach(GTK_GRID(ugrid), btn_cancel, 1, 5, 1, 1);
+
+    UpdateData *ud = form_state_new(uwin, sizeof(UpdateData));
+    if (!ud) { gtk_widget_destroy(uwin); return; }
+    ud->ent_roll_readonly = ent_rollr; ud->ent_name = ent_name; ud->ent_section = ent_section;
+    ud->ent_marks = ent_marks; ud->ent_grade = ent_grade; ud->parent = GTK_WINDOW(uwin);
+
+    g_signal_connect_swapped(btn_cancel, "clicked", G_CALLBACK(gtk_widget_destroy), uwin);
+    g_signal_connect(btn_save, "clicked", G_CALLBACK(on_update_save_clicked), ud);
+
+    gtk_widget_show_all(uwin);
+}
+
+static void update_found(IoJob *job) {
+    int idx = find_by_roll(job->arr, job->n, *(int *)job->data);
+    if (idx == -1) show_message(job->parent, "Not found", "Record not found.");
+    else show_update_window(job->parent, &job->arr[idx]);
 }
 
 static void on_update_clicked(GtkButton *b, gpointer user_data) {
     GtkWindow *parent = GTK_WINDOW(user_data);
-
-    GtkWidget *dialog = gtk_dialog_new_with_buttons("Find Student to Update", parent,
-        GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
-        "Find", GTK_RESPONSE_OK, "Cancel", GTK_RESPONSE_CANCEL, NULL);
-    GtkWidget *content = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
-    GtkWidget *grid = gtk_grid_new();
-    gtk_container_add(GTK_CONTAINER(content), grid);
-    GtkWidget *lbl = gtk_label_new("Enter Roll to update:");
-    GtkWidget *ent_roll = gtk_entry_new();
-    gtk_grid_attach(GTK_GRID(grid), lbl, 0, 0, 1, 1);
-    gtk_grid_attach(GTK_GRID(grid), ent_roll, 1, 0, 1, 1);
-    gtk_widget_show_all(dialog);
-    gint resp = gtk_dialog_run(GTK_DIALOG(dialog));
-    if (resp == GTK_RESPONSE_OK) {
-        int roll = atoi(gtk_entry_get_text(GTK_ENTRY(ent_roll)));
-        if (roll <= 0) show_error(parent, "Input Error", "Invalid roll.");
-        else {
-            Student arr[MAX_STUDENTS]; int n = load_students(arr); int idx = -1;
-            for (int i = 0; i < n; ++i) if (arr[i].roll == roll) { idx = i; break; }
-            if (idx == -1) show_message(parent, "Not found", "Record not found.");
-            else {
-                GtkWidget *uwin = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-                gtk_window_set_transient_for(GTK_WINDOW(uwin), parent);
-                gtk_window_set_title(GTK_WINDOW(uwin), "Update Student");
-                gtk_window_set_default_size(GTK_WINDOW(uwin), 420, 260);
-                GtkWidget *ugrid = gtk_grid_new();
-                gtk_container_add(GTK_CONTAINER(uwin), ugrid);
-                gtk_grid_set_row_spacing(GTK_GRID(ugrid), 6); gtk_grid_set_column_spacing(GTK_GRID(ugrid), 8);
-                gtk_container_set_border_width(GTK_CONTAINER(ugrid), 10);
-
-                GtkWidget *lbl_rollr = gtk_label_new("Roll (readonly):");
-                GtkWidget *ent_rollr = gtk_entry_new();
-                char tmp[32]; snprintf(tmp, sizeof(tmp), "%d", arr[idx].roll);
-                gtk_entry_set_text(GTK_ENTRY(ent_rollr), tmp);
-                gtk_editable_set_editable(GTK_EDITABLE(ent_rollr), FALSE);
-
-                GtkWidget *lbl_name = gtk_label_new("Name:");
-                GtkWidget *ent_name = gtk_entry_new();
-                gtk_entry_set_text(GTK_ENTRY(ent_name), arr[idx].name);
-
-                GtkWidget *lbl_section = gtk_label_new("Section:");
-                GtkWidget *ent_section = gtk_entry_new();
-                gtk_entry_set_text(GTK_ENTRY(ent_section), arr[idx].section);
-
-                GtkWidget *lbl_marks = gtk_label_new("Marks (0-100):");
-                GtkWidget *ent_marks = gtk_entry_new();
-                char tmpm[32]; snprintf(tmpm, sizeof(tmpm), "%.2f", arr[idx].marks);
-                gtk_entry_set_text(GTK_ENTRY(ent_marks), tmpm);
-
-                GtkWidget *lbl_grade = gtk_label_new("Grade (leave blank to auto-calc):");
-                GtkWidget *ent_grade = gtk_entry_new();
-                gtk_entry_set_text(GTK_ENTRY(ent_grade), arr[idx].grade);
-
-                GtkWidget *btn_save = gtk_button_new_with_label("Save");
-                GtkWidget *btn_cancel = gtk_button_new_with_label("Cancel");
-
-                gtk_grid_attach(GTK_GRID(ugrid), lbl_rollr, 0, 0, 1, 1);
-                gtk_grid_attach(GTK_GRID(ugrid), ent_rollr, 1, 0, 1, 1);
-                gtk_grid_attach(GTK_GRID(ugrid), lbl_name, 0, 1, 1, 1);
-                gtk_grid_attach(GTK_GRID(ugrid), ent_name, 1, 1, 1, 1);
-                gtk_grid_attach(GTK_GRID(ugrid), lbl_section, 0, 2, 1, 1);
-                gtk_grid_attach(GTK_GRID(ugrid), ent_section, 1, 2, 1, 1);
-                gtk_grid_attach(GTK_GRID(ugrid), lbl_marks, 0, 3, 1, 1);
-                gtk_grid_attach(GTK_GRID(ugrid), ent_marks, 1, 3, 1, 1);
-                gtk_grid_attach(GTK_GRID(ugrid), lbl_grade, 0, 4, 1, 1);
-                gtk_grid_attach(GTK_GRID(ugrid), ent_grade, 1, 4, 1, 1);
-                gtk_grid_attach(GTK_GRID(ugrid), btn_save, 0, 5, 1, 1);
-                gtk_grid_attach(GTK_GRID(ugrid), btn_cancel, 1, 5, 1, 1);
-
-                UpdateData *ud = g_malloc(sizeof(UpdateData));
-                ud->ent_roll_readonly = ent_rollr; ud->ent_name = ent_name; ud->ent_section = ent_section;
-                ud->ent_marks = ent_marks; ud->ent_grade = ent_grade; ud->parent = GTK_WINDOW(uwin);
-
-                g_signal_connect(btn_cancel, "clicked", G_CALLBACK(gtk_widget_destroy), uwin);
-                g_signal_connect(btn_save, "clicked", G_CALLBACK(on_update_save_clicked), ud);
-
-                gtk_widget_show_all(uwin);
-            }
-        }
-    }
-    gtk_widget_destroy(dialog);
+    int roll = ask_roll(parent, "Find Student to Update", "Find", "Enter Roll to update:");
+    if (roll) load_for_roll(parent, roll, update_found);
 }
 
 /* ---------- Sort ---------- */
 
+static void sort_work(IoJob *job) {
+    int by_roll = *(int *)job->data == 1;
+    const char *key = by_roll ? CACHE_SORT_ROLL : CACHE_SORT_MARKS;
+    if ((job->n = cached_students(key, job->arr)) > 0) return;
+    job->n = load_roster(job->arr);
+    if (job->n == 0) return;
+    unsigned long long t0 = metrics_start();
+    qsort(job->arr, job->n, sizeof(Student), by_roll ? cmp_roll_asc : cmp_marks_desc);
+    metrics_end(M_SORT, t0, 0);
+    cache_put(key, loaded_generation, job->arr, sizeof(Student) * job->n);
+}
+
+static void sort_done(IoJob *job) {
+    if (job->n == 0) show_message(job->parent, "No records", "No records to sort.");
+    else show_students_list_window(job->parent, "Sorted Students", job->arr, job->n);
+}
+
 static void on_sort_clicked(GtkButton *b, gpointer user_data) {
     GtkWindow *parent = GTK_WINDOW(user_data);
     GtkWidget *dialog = gtk_dialog_new_with_buttons("Sort Records", parent,
@@ -466,16 +831,31 @@ static void on_sort_clicked(GtkButton *b, gpointer user_data) {
     gint resp = gtk_dialog_run(GTK_DIALOG(dialog));
     gtk_widget_destroy(dialog);
     if (resp == 1 || resp == 2) {
-        Student arr[MAX_STUDENTS]; int n = load_students(arr);
-        if (n == 0) { show_message(parent, "No records", "No records to sort."); return; }
-        if (resp == 1) qsort(arr, n, sizeof(Student), cmp_roll_asc);
-        else qsort(arr, n, sizeof(Student), cmp_marks_desc);
-        show_students_list_window(parent, "Sorted Students", arr, n);
+        IoJob *job = io_job_new(parent, MAX_STUDENTS, sizeof(int));
+        if (!job) return;
+        *(int *)job->data = resp;
+        io_job_run(job, sort_work, sort_done);
     }
 }
 
 /* ---------- Top N ---------- */
 
+static void topn_work(IoJob *job) {
+    if ((job->n = cached_students(CACHE_SORT_MARKS, job->arr)) > 0) return;
+    job->n = load_roster(job->arr);
+    if (job->n == 0) return;
+    unsigned long long t0 = metrics_start();
+    qsort(job->arr, job->n, sizeof(Student), cmp_marks_desc);
+    metrics_end(M_TOP_N, t0, 0);
+    cache_put(CACHE_SORT_MARKS, loaded_generation, job->arr, sizeof(Student) * job->n);
+}
+
+static void topn_done(IoJob *job) {
+    int N = *(int *)job->data;
+    if (job->n == 0) show_message(job->parent, "No records", "No records.");
+    else show_students_list_window(job->parent, "Top Students", job->arr, (N < job->n) ? N : job->n);
+}
+
 static void on_topn_clicked(GtkButton *b, gpointer user_data) {
     GtkWindow *parent = GTK_WINDOW(user_data);
     GtkWidget *dialog = gtk_dialog_new_with_buttons("Top N Students", parent,
@@ -494,46 +874,243 @@ static void on_topn_clicked(GtkButton *b, gpointer user_data) {
         int N = atoi(gtk_entry_get_text(GTK_ENTRY(ent)));
         if (N <= 0) show_error(parent, "Input Error", "Invalid N.");
         else {
-            Student arr[MAX_STUDENTS]; int n = load_students(arr);
-            if (n == 0) show_message(parent, "No records", "No records.");
-            else {
-                qsort(arr, n, sizeof(Student), cmp_marks_desc);
-                show_students_list_window(parent, "Top Students", arr, (N < n) ? N : n);
-            }
+            IoJob *job = io_job_new(parent, MAX_STUDENTS, sizeof(int));
+            if (!job) return;
+            *(int *)job->data = N;
+            io_job_run(job, topn_work, topn_done);
         }
     }
     gtk_widget_destroy(dialog);
 }
 
-/* ---------- Stats & Count ---------- */
+/* ---------- Query ---------- */
 
-static void on_statistics_clicked(GtkButton *b, gpointer user_data) {
+static void query_work(IoJob *job) {
+    const Query *q = job->data;
+    char key[CACHE_KEY_LEN];
+    int keyed = query_key(q, key, sizeof(key));
+    if (keyed && (job->n = cached_students(key, job->arr)) >= 0) return;
+    job->n = run_query(job->arr, load_roster(job->arr), q);
+    if (keyed) cache_put(key, loaded_generation, job->arr, sizeof(Student) * job->n);
+}
+
+static void query_done(IoJob *job) {
+    if (job->n == 0) show_message(job->parent, "No records", "No matching records.");
+    else show_students_list_window(job->parent, "Query Result", job->arr, job->n);
+}
+
+static void on_query_clicked(GtkButton *b, gpointer user_data) {
     GtkWindow *parent = GTK_WINDOW(user_data);
-    Student arr[MAX_STUDENTS]; int n = load_students(arr);
-    if (n == 0) { show_message(parent, "No records", "No records."); return; }
-    float total = 0; float max = arr[0].marks, min = arr[0].marks; int grade_counts[6] = {0};
-    for (int i = 0; i < n; ++i) {
-        float m = arr[i].marks; total += m;
-        if (m > max) max = m; if (m < min) min = m;
-        if (strcmp(arr[i].grade, "A+")==0) grade_counts[0]++;
-        else if (strcmp(arr[i].grade,"A")==0) grade_counts[1]++;
-        else if (strcmp(arr[i].grade,"B+")==0) grade_counts[2]++;
-        else if (strcmp(arr[i].grade,"B")==0) grade_counts[3]++;
-        else if (strcmp(arr[i].grade,"C")==0) grade_counts[4]++;
-        else grade_counts[5]++;
+    GtkWidget *dialog = gtk_dialog_new_with_buttons("Query Records", parent,
+        GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+        "Run", GTK_RESPONSE_OK, "Cancel", GTK_RESPONSE_CANCEL, NULL);
+    GtkWidget *content = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget *grid = gtk_grid_new();
+    gtk_container_add(GTK_CONTAINER(content), grid);
+    gtk_grid_set_row_spacing(GTK_GRID(grid), 6); gtk_grid_set_column_spacing(GTK_GRID(grid), 6);
+    GtkWidget *lbl = gtk_label_new("Fields: roll name section marks grade; operators: == != < <= > >=");
+    GtkWidget *ent = gtk_entry_new();
+    gtk_entry_set_width_chars(GTK_ENTRY(ent), 48);
+    gtk_entry_set_placeholder_text(GTK_ENTRY(ent), "section == \"A\" && marks >= 75 order by marks desc limit 20");
+    gtk_grid_attach(GTK_GRID(grid), lbl, 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), ent, 0, 1, 1, 1);
+    gtk_widget_show_all(dialog);
+    gint resp = gtk_dialog_run(GTK_DIALOG(dialog));
+    if (resp == GTK_RESPONSE_OK) {
+        Query q; char err[128];
+        if (!compile_query(gtk_entry_get_text(GTK_ENTRY(ent)), &q, err, sizeof(err)))
+            show_error(parent, "Query Error", err);
+        else {
+            IoJob *job = io_job_new(parent, MAX_STUDENTS, sizeof(Query));
+            if (!job) return;
+            memcpy(job->data, &q, sizeof(q));
+            io_job_run(job, query_work, query_done);
+        }
     }
-    char buf[512];
-    snprintf(buf, sizeof(buf),
+    gtk_widget_destroy(dialog);
+}
+
+/* ---------- Stats & Count ---------- */
+
+static void show_statistics(GtkWindow *parent, const StatsReport *r) {
+    GString *text = g_string_new(NULL);
+    g_string_append_printf(text,
         "Total students: %d\nAverage marks: %.2f\nMax marks: %.2f\nMin marks: %.2f\n\nGrade distribution:\nA+: %d\nA: %d\nB+: %d\nB: %d\nC: %d\nF/others: %d",
-        n, total / n, max, min, grade_counts[0], grade_counts[1], grade_counts[2], grade_counts[3], grade_counts[4], grade_counts[5]);
-    show_message(parent, "Statistics", buf);
+        r->n, r->total / r->n, r->max, r->min, r->grade_counts[0], r->grade_counts[1], r->grade_counts[2],
+        r->grade_counts[3], r->grade_counts[4], r->grade_counts[5]);
+
+    g_string_append_printf(text,
+        "\n\nMedian marks: %.2f\nStd deviation: %.2f\nPercentiles: P10 %.2f, P25 %.2f, P75 %.2f, P90 %.2f",
+        r->median, r->stddev, r->p10, r->p25, r->p75, r->p90);
+
+    g_string_append(text, "\n\nBy section (count, avg, min, max; A+/A/B+/B/C/F):");
+    for (int i = 0; i < r->ngroups; ++i) {
+        const SectionStats *g = &r->groups[i];
+        g_string_append_printf(text, "\n%s: %d, %.2f, %.2f, %.2f; %d/%d/%d/%d/%d/%d",
+            g->section, g->count, g->total / g->count, g->min, g->max,
+            g->grade_counts[0], g->grade_counts[1], g->grade_counts[2],
+            g->grade_counts[3], g->grade_counts[4], g->grade_counts[5]);
+    }
+
+    show_message(parent, "Statistics", text->str);
+    g_string_free(text, TRUE);
+}
+
+static void statistics_work(IoJob *job) {
+    StatsReport *r = job->data;
+    if (cache_get(CACHE_STATISTICS, store_generation(), r, sizeof(*r)) >= 0 && r->n > 0) return;
+    int n = load_roster(job->arr);
+    r->n = 0;
+    if (n == 0) return;
+    unsigned long long t0 = metrics_start();
+    size_t size = stats_report(job->arr, n, r);
+    metrics_end(M_STATS, t0, 0);
+    cache_put(CACHE_STATISTICS, loaded_generation, r, size);
+}
+
+static void statistics_done(IoJob *job) {
+    StatsReport *r = job->data;
+    if (r->n == 0) show_message(job->parent, "No records", "No records.");
+    else show_statistics(job->parent, r);
+}
+
+static void on_statistics_clicked(GtkButton *b, gpointer user_data) {
+    IoJob *job = io_job_new(GTK_WINDOW(user_data), MAX_STUDENTS, sizeof(StatsReport));
+    if (job) io_job_run(job, statistics_work, statistics_done);
+}
+
+typedef struct {
+    int roll;
+    RankInfo info;
+} RankJob;
+
+static void rank_work(IoJob *job) {
+    RankJob *r = job->data;
+    job->result = rank_of_roll(r->roll, &r->info);
+}
+
+static void rank_done(IoJob *job) {
+    RankJob *r = job->data;
+    if (job->result < 0) show_error(job->parent, "Error", "Could not load records.");
+    else if (!job->result) show_message(job->parent, "Not found", "Record not found.");
+    else {
+        char buf[160];
+        snprintf(buf, sizeof(buf), "%s (roll %d) with %.2f marks ranks %d of %d\n(above %.1f%% of students).",
+            r->info.rec.name, r->roll, r->info.rec.marks, r->info.rank, r->info.n, 100.0 * r->info.below / r->info.n);
+        show_message(job->parent, "Rank", buf);
+    }
+}
+
+static void on_rank_clicked(GtkButton *b, gpointer user_data) {
+    GtkWindow *parent = GTK_WINDOW(user_data);
+    int roll = ask_roll(parent, "Rank by Roll", "Rank", "Enter Roll:");
+    if (!roll) return;
+    IoJob *job = io_job_new(parent, 0, sizeof(RankJob));
+    if (!job) return;
+    ((RankJob *)job->data)->roll = roll;
+    io_job_run(job, rank_work, rank_done);
+}
+
+static void on_perf_stats_clicked(GtkButton *b, gpointer user_data) {
+    GtkWindow *parent = GTK_WINDOW(user_data);
+    FILE *tmp = tmpfile();
+    if (!tmp) { show_error(parent, "Error", "Cannot create a temporary file."); return; }
+    metrics_print(tmp);
+    long len = ftell(tmp);
+    char *text = g_malloc0(len + 1);
+    rewind(tmp);
+    if (fread(text, 1, len, tmp) != (size_t)len) text[0] = 0;
+    fclose(tmp);
+    char *esc = g_markup_escape_text(text, -1);
+    GtkWidget *d = gtk_message_dialog_new(parent,
+        GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+        GTK_MESSAGE_INFO, GTK_BUTTONS_OK, "Performance stats (this session)");
+    gtk_message_dialog_format_secondary_markup(GTK_MESSAGE_DIALOG(d), "<tt>%s</tt>", esc);
+    gtk_window_set_title(GTK_WINDOW(d), "Performance Stats");
+    gtk_dialog_run(GTK_DIALOG(d));
+    gtk_widget_destroy(d);
+    g_free(esc);
+    g_free(text);
+}
+
+static void count_work(IoJob *job) {
+    job->n = count_students();
+}
+
+static void count_done(IoJob *job) {
+    char buf[64]; snprintf(buf, sizeof(buf), "Total students: %d", job->n);
+    show_message(job->parent, "Count", buf);
 }
 
 static void on_count_clicked(GtkButton *b, gpointer user_data) {
+    IoJob *job = io_job_new(GTK_WINDOW(user_data), 0, 0);
+    if (job) io_job_run(job, count_work, count_done);
+}
+
+/* ---------- Curve marks ---------- */
+
+typedef struct {
+    char section[10];
+    float factor, offset;
+    int changed;
+} CurveJob;
+
+static void curve_work(IoJob *job) {
+    CurveJob *c = job->data;
+    job->n = load_roster(job->arr);
+    c->changed = apply_curve(job->arr, job->n, c->section, c->factor, c->offset);
+    if (c->changed > 0) save_work(job);
+}
+
+static void curve_done(IoJob *job) {
+    CurveJob *c = job->data;
+    if (c->changed == 0) { show_message(job->parent, "No records", "No matching records."); return; }
+    if (job->result != STORE_OK) { show_error(job->parent, "Error", save_error_message(job->result)); return; }
+    char buf[64]; snprintf(buf, sizeof(buf), "%d record(s) updated.", c->changed);
+    show_message(job->parent, "Curve applied", buf);
+}
+
+static void on_curve_clicked(GtkButton *b, gpointer user_data) {
     GtkWindow *parent = GTK_WINDOW(user_data);
-    Student arr[MAX_STUDENTS]; int n = load_students(arr);
-    char buf[64]; snprintf(buf, sizeof(buf), "Total students: %d", n);
-    show_message(parent, "Count", buf);
+    GtkWidget *dialog = gtk_dialog_new_with_buttons("Curve Marks", parent,
+        GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+        "Apply", GTK_RESPONSE_OK, "Cancel", GTK_RESPONSE_CANCEL, NULL);
+    GtkWidget *content = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    GtkWidget *grid = gtk_grid_new();
+    gtk_container_add(GTK_CONTAINER(content), grid);
+    gtk_grid_set_row_spacing(GTK_GRID(grid), 6); gtk_grid_set_column_spacing(GTK_GRID(grid), 6);
+    GtkWidget *lbl_section = gtk_label_new("Section (blank = all):");
+    GtkWidget *ent_section = gtk_entry_new();
+    GtkWidget *lbl_factor = gtk_label_new("Factor:");
+    GtkWidget *ent_factor = gtk_entry_new();
+    gtk_entry_set_text(GTK_ENTRY(ent_factor), "1");
+    GtkWidget *lbl_offset = gtk_label_new("Offset:");
+    GtkWidget *ent_offset = gtk_entry_new();
+    gtk_entry_set_text(GTK_ENTRY(ent_offset), "0");
+    gtk_grid_attach(GTK_GRID(grid), lbl_section, 0, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), ent_section, 1, 0, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), lbl_factor, 0, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), ent_factor, 1, 1, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), lbl_offset, 0, 2, 1, 1);
+    gtk_grid_attach(GTK_GRID(grid), ent_offset, 1, 2, 1, 1);
+    gtk_widget_show_all(dialog);
+    gint resp = gtk_dialog_run(GTK_DIALOG(dialog));
+    float factor = atof(gtk_entry_get_text(GTK_ENTRY(ent_factor)));
+    float offset = atof(gtk_entry_get_text(GTK_ENTRY(ent_offset)));
+    if (resp == GTK_RESPONSE_OK && !(isfinite(factor) && isfinite(offset)))
+        show_error(parent, "Input Error", "Factor and offset must be numbers.");
+    else if (resp == GTK_RESPONSE_OK) {
+        /* The load, the curve and the save all happen on the worker. */
+        IoJob *job = io_job_new(parent, MAX_STUDENTS, sizeof(CurveJob));
+        if (job) {
+            CurveJob *c = job->data;
+            strncpy(c->section, gtk_entry_get_text(GTK_ENTRY(ent_section)), sizeof(c->section)-1);
+            c->factor = factor;
+            c->offset = offset;
+            io_job_run(job, curve_work, curve_done);
+        }
+    }
+    gtk_widget_destroy(dialog);
 }
 
 /* ---------- Main window (no login) ---------- */
@@ -588,6 +1165,22 @@ static void build_main_window(void) {
     gtk_grid_attach(GTK_GRID(grid), btn_delete, 0, row, 1, 1);
     g_signal_connect(btn_delete, "clicked", G_CALLBACK(on_delete_clicked), main_window);
 
+    GtkWidget *btn_curve = gtk_button_new_with_label("Curve marks");
+    gtk_grid_attach(GTK_GRID(grid), btn_curve, 1, row++, 1, 1);
+    g_signal_connect(btn_curve, "clicked", G_CALLBACK(on_curve_clicked), main_window);
+
+    GtkWidget *btn_rank = gtk_button_new_with_label("Rank of a student");
+    gtk_grid_attach(GTK_GRID(grid), btn_rank, 0, row, 1, 1);
+    g_signal_connect(btn_rank, "clicked", G_CALLBACK(on_rank_clicked), main_window);
+
+    GtkWidget *btn_query = gtk_button_new_with_label("Query records");
+    gtk_grid_attach(GTK_GRID(grid), btn_query, 1, row++, 1, 1);
+    g_signal_connect(btn_query, "clicked", G_CALLBACK(on_query_clicked), main_window);
+
+    GtkWidget *btn_perf = gtk_button_new_with_label("Performance stats");
+    gtk_grid_attach(GTK_GRID(grid), btn_perf, 0, row, 1, 1);
+    g_signal_connect(btn_perf, "clicked", G_CALLBACK(on_perf_stats_clicked), main_window);
+
     GtkWidget *btn_exit = gtk_button_new_with_label("Exit");
     gtk_grid_attach(GTK_GRID(grid), btn_exit, 0, row+1, 2, 1);
     g_signal_connect_swapped(btn_exit, "clicked", G_CALLBACK(gtk_widget_destroy), main_window);
@@ -599,7 +1192,11 @@ static void build_main_window(void) {
 /* ---------- main ---------- */
 
 int main(int argc, char *argv[]) {
+    metrics_init();
+    launch_t0 = metrics_start();
+    start_prefetch(); /* overlaps with GTK start-up and window realization */
     gtk_init(&argc, &argv);
+    load_grade_policy();
     build_main_window();
     gtk_main();
     return 0;
@@ -1,78 +1,28 @@
 // student_terminal_full.c
-// Compile:
-//   gcc student_terminal_full.c -o student
+// Compile (from the repository root):
+//   make student
+// or
+//   gcc "Terminal Based/Student Management System.c" store/*.c -o student -lm
 // Run:
 //   ./student
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define write _write
+#else
+#include <unistd.h>
+#endif
 
-#define FILE_NAME "student.txt"
-#define MAX_STUDENTS 2000
-
-typedef struct
-{
-    int roll;
-    char name[50];
-    char section[10];
-    float marks;
-    char grade[6]; // e.g. "A+", "B"
-} Student;
+#include "../store/student_store.h"
 
 char current_role[16] = ""; // "admin" or "teacher"
 
-/* ---------------- Utilities: File I/O ---------------- */
-
-void calc_grade_from_marks(Student *s)
-{
-    if (s->marks >= 90) strcpy(s->grade, "A+");
-    else if (s->marks >= 80) strcpy(s->grade, "A");
-    else if (s->marks >= 70) strcpy(s->grade, "B+");
-    else if (s->marks >= 60) strcpy(s->grade, "B");
-    else if (s->marks >= 50) strcpy(s->grade, "C");
-    else strcpy(s->grade, "F");
-}
-
-int load_students(Student arr[])
-{
-    FILE *fp = fopen(FILE_NAME, "rb");
-    if (!fp) return 0;
-    int cnt = 0;
-    while (cnt < MAX_STUDENTS && fread(&arr[cnt], sizeof(Student), 1, fp) == 1) cnt++;
-    fclose(fp);
-    return cnt;
-}
-
-void save_all_students(Student arr[], int n)
-{
-    FILE *fp = fopen(FILE_NAME, "wb");
-    if (!fp)
-    {
-        printf("Error: cannot write to %s\n", FILE_NAME);
-        return;
-    }
-    fwrite(arr, sizeof(Student), n, fp);
-    fclose(fp);
-}
-
-void append_student(const Student *s)
-{
-    FILE *fp = fopen(FILE_NAME, "ab");
-    if (!fp)
-    {
-        // If file doesn't exist, try creating by saving single record
-        fp = fopen(FILE_NAME, "wb");
-        if (!fp)
-        {
-            printf("Error: cannot open file for writing\n");
-            return;
-        }
-    }
-    fwrite(s, sizeof(Student), 1, fp);
-    fclose(fp);
-}
-
 /* ---------------- Input Helpers ---------------- */
 
 // Read a whole line into buf (size bytes), strip newline. Returns 1 on success.
@@ -122,7 +72,7 @@ int read_float_with_default(float *out_val, int allow_blank, float default_val)
         }
     }
     float val;
-    if (sscanf(buf, "%f", &val) == 1)
+    if (sscanf(buf, "%f", &val) == 1 && isfinite(val)) // "nan" and "inf" scan too
     {
         *out_val = val;
         return 1;
@@ -132,19 +82,143 @@ int read_float_with_default(float *out_val, int allow_blank, float default_val)
 
 /* ---------------- Display helpers ---------------- */
 
+// Rows are rendered by hand into row_buf and written with one write() per
+// 64 KB, so long listings are not bound by printf's format parsing. When
+// stdout is not a terminal (a pipe or a file) the table borders are left
+// out and fields are tab-separated.
+
+#define ROW_BUF_SIZE 65536
+#define ROW_MAX 192 // longest rendered row
+
+static char row_buf[ROW_BUF_SIZE];
+static int row_len = 0;
+int plain_output = 0;
+
+void flush_rows()
+{
+    fflush(stdout); // keep order with anything printf'd before the rows
+    int off = 0;
+    while (off < row_len)
+    {
+        int w = (int)write(1, row_buf + off, row_len - off);
+        if (w <= 0) break;
+        off += w;
+    }
+    row_len = 0;
+}
+
+static char *put_str(char *p, const char *str, int maxlen, int width)
+{
+    int len = (int)strnlen(str, maxlen);
+    memcpy(p, str, len);
+    p += len;
+    for (; len < width; ++len) *p++ = ' ';
+    return p;
+}
+
+static char *put_int(char *p, int v, int width)
+{
+    char tmp[12];
+    int len = 0;
+    unsigned int u = v < 0 ? 0u - (unsigned int)v : (unsigned int)v;
+    do tmp[len++] = (char)('0' + u % 10);
+    while (u /= 10);
+    if (v < 0) tmp[len++] = '-';
+    for (int i = len - 1; i >= 0; --i) *p++ = tmp[i];
+    for (; len < width; ++len) *p++ = ' ';
+    return p;
+}
+
+// Same digits as "%.2f": marks * 100 is exact in a double, and nearbyint
+// rounds ties to even as printf does.
+static char *put_marks(char *p, float marks, int width)
+{
+    char tmp[48];
+    int len = 0;
+    double x = (double)marks * 100.0;
+    if (fabs(x) < 1e15)
+    {
+        long long c = (long long)nearbyint(x);
+        unsigned long long u = c < 0 ? 0ULL - (unsigned long long)c : (unsigned long long)c;
+        char digits[24];
+        int nd = 0;
+        do digits[nd++] = (char)('0' + u % 10);
+        while (u /= 10);
+        while (nd < 3) digits[nd++] = '0';
+        if (signbit(x)) tmp[len++] = '-';
+        for (int i = nd - 1; i >= 2; --i) tmp[len++] = digits[i];
+        tmp[len++] = '.';
+        tmp[len++] = digits[1];
+        tmp[len++] = digits[0];
+    }
+    else
+    {
+        len = snprintf(tmp, sizeof(tmp), "%.2f", marks);
+        if (len >= (int)sizeof(tmp)) len = sizeof(tmp) - 1;
+    }
+    memcpy(p, tmp, len);
+    p += len;
+    for (; len < width; ++len) *p++ = ' ';
+    return p;
+}
+
 void print_student_row(const Student *s)
 {
-    printf("| %-6d | %-20s | %-8s | %-7.2f | %-3s |\n",
-           s->roll, s->name, s->section, s->marks, s->grade);
+    if (row_len > ROW_BUF_SIZE - ROW_MAX) flush_rows();
+    char *p = row_buf + row_len;
+    if (plain_output)
+    {
+        p = put_int(p, s->roll, 0);
+        *p++ = '\t';
+        p = put_str(p, s->name, sizeof(s->name), 0);
+        *p++ = '\t';
+        p = put_str(p, s->section, sizeof(s->section), 0);
+        *p++ = '\t';
+        p = put_marks(p, s->marks, 0);
+        *p++ = '\t';
+        p = put_str(p, s->grade, sizeof(s->grade), 0);
+    }
+    else
+    {
+        memcpy(p, "| ", 2); p += 2;
+        p = put_int(p, s->roll, 6);
+        memcpy(p, " | ", 3); p += 3;
+        p = put_str(p, s->name, sizeof(s->name), 20);
+        memcpy(p, " | ", 3); p += 3;
+        p = put_str(p, s->section, sizeof(s->section), 8);
+        memcpy(p, " | ", 3); p += 3;
+        p = put_marks(p, s->marks, 7);
+        memcpy(p, " | ", 3); p += 3;
+        p = put_str(p, s->grade, sizeof(s->grade), 3);
+        memcpy(p, " |", 2); p += 2;
+    }
+    *p++ = '\n';
+    row_len = (int)(p - row_buf);
 }
 
 void print_table_header()
 {
+    if (plain_output) return;
     printf("+--------+----------------------+----------+---------+-----+\n");
     printf("| Roll   | Name                 | Section  | Marks   | G   |\n");
     printf("+--------+----------------------+----------+---------+-----+\n");
 }
 
+void print_table_footer()
+{
+    flush_rows();
+    if (!plain_output) printf("+--------+----------------------+----------+---------+-----+\n");
+}
+
+// Explains a failed save_all_students. Returns 1 if the save succeeded.
+int report_save(int result)
+{
+    if (result == STORE_CONFLICT) printf("Records were changed by another user. Please retry.\n");
+    else if (result == STORE_INVALID) printf("Marks must be between 0 and 100. Nothing was saved.\n");
+    else if (result != STORE_OK) printf("Error: could not save records.\n");
+    return result == STORE_OK;
+}
+
 /* ---------------- Authentication ---------------- */
 
 int login_prompt()
@@ -220,23 +294,45 @@ void insert_record_terminal()
         s.grade[sizeof(s.grade)-1] = '\0';
     }
 
-    append_student(&s);
-    printf("Student inserted successfully.\n");
+    int r = insert_student(&s);
+    if (r == STORE_DUPLICATE) printf("Roll number already exists. Record not inserted.\n");
+    else if (r == STORE_OK) printf("Student inserted successfully.\n");
 }
 
+#define SCREEN_ROWS 20
+
+// Reads the file a page at a time, so the first screen appears at once on
+// any roster size. Pauses between screens only when a person is typing.
 void display_all_records_terminal()
 {
-    Student arr[MAX_STUDENTS];
-    int n = load_students(arr);
+    PagedReader *pr = pager_open(0);
+    int n = pr ? pager_count(pr) : 0;
     if (n == 0)
     {
         printf("No records found.\n");
+        pager_close(pr);
         return;
     }
+    int pause = isatty(0) && !plain_output;
+    char buf[16];
     print_table_header();
-    for (int i = 0; i < n; ++i) print_student_row(&arr[i]);
-    printf("+--------+----------------------+----------+---------+-----+\n");
+    int shown = 0;
+    const Student *s;
+    while ((s = pager_get(pr, shown)) != NULL)
+    {
+        print_student_row(s);
+        ++shown;
+        if (pause && shown % SCREEN_ROWS == 0 && shown < n)
+        {
+            flush_rows();
+            printf("-- %d of %d, Enter for more, q to stop --", shown, n);
+            fflush(stdout);
+            if (!read_line(buf, sizeof(buf)) || buf[0] == 'q' || buf[0] == 'Q') break;
+        }
+    }
+    print_table_footer();
     printf("Total records: %d\n", n);
+    pager_close(pr);
 }
 
 void search_record_terminal()
@@ -253,17 +349,15 @@ void search_record_terminal()
     }
     Student arr[MAX_STUDENTS];
     int n = load_students(arr);
-    for (int i = 0; i < n; ++i)
+    int idx = find_by_roll(arr, n, roll);
+    if (idx == -1)
     {
-        if (arr[i].roll == roll)
-        {
-            print_table_header();
-            print_student_row(&arr[i]);
-            printf("+--------+----------------------+----------+---------+-----+\n");
-            return;
-        }
+        printf("Record not found.\n");
+        return;
     }
-    printf("Record not found.\n");
+    print_table_header();
+    print_student_row(&arr[idx]);
+    print_table_footer();
 }
 
 void update_record_terminal()
@@ -285,12 +379,7 @@ void update_record_terminal()
     }
     Student arr[MAX_STUDENTS];
     int n = load_students(arr);
-    int idx = -1;
-    for (int i = 0; i < n; ++i) if (arr[i].roll == roll)
-        {
-            idx = i;
-            break;
-        }
+    int idx = find_by_roll(arr, n, roll);
     if (idx == -1)
     {
         printf("Record not found.\n");
@@ -324,8 +413,7 @@ void update_record_terminal()
         arr[idx].grade[sizeof(arr[idx].grade)-1] = '\0';
     }
 
-    save_all_students(arr, n);
-    printf("Record updated successfully.\n");
+    if (report_save(save_all_students(arr, n))) printf("Record updated successfully.\n");
 }
 
 void delete_record_terminal()
@@ -347,12 +435,7 @@ void delete_record_terminal()
     }
     Student arr[MAX_STUDENTS];
     int n = load_students(arr);
-    int idx = -1;
-    for (int i = 0; i < n; ++i) if (arr[i].roll == roll)
-        {
-            idx = i;
-            break;
-        }
+    int idx = find_by_roll(arr, n, roll);
     if (idx == -1)
     {
         printf("Record not found.\n");
@@ -360,24 +443,21 @@ void delete_record_terminal()
     }
     // shift left
     for (int i = idx; i < n - 1; ++i) arr[i] = arr[i+1];
-    save_all_students(arr, n - 1);
-    printf("Record deleted successfully.\n");
+    if (report_save(save_all_students(arr, n - 1))) printf("Record deleted successfully.\n");
 }
 
-/* Sorting helpers */
-int cmp_roll_asc(const void *a, const void *b)
-{
-    Student *A = (Student*)a;
-    Student *B = (Student*)b;
-    return (A->roll - B->roll);
-}
-int cmp_marks_desc(const void *a, const void *b)
+// Loads the records sorted by cmp, from the result cache when the file is
+// unchanged since the same sort was last done. Returns the record count.
+int load_sorted(const char *key, Student arr[], int (*cmp)(const void *, const void *), int metric)
 {
-    Student *A = (Student*)a;
-    Student *B = (Student*)b;
-    if (A->marks < B->marks) return 1;
-    if (A->marks > B->marks) return -1;
-    return 0;
+    long got = cache_get(key, store_generation(), arr, sizeof(Student) * MAX_STUDENTS);
+    if (got >= 0) return (int)(got / sizeof(Student));
+    int n = load_students(arr);
+    unsigned long long t0 = metrics_start();
+    qsort(arr, n, sizeof(Student), cmp);
+    metrics_end(metric, t0, 0);
+    cache_put(key, loaded_generation, arr, sizeof(Student) * n);
+    return n;
 }
 
 void sort_records_terminal()
@@ -388,17 +468,16 @@ void sort_records_terminal()
     read_line(buf, sizeof(buf));
     int opt = atoi(buf);
     Student arr[MAX_STUDENTS];
-    int n = load_students(arr);
+    int n = opt == 1 ? load_sorted(CACHE_SORT_ROLL, arr, cmp_roll_asc, M_SORT)
+                     : load_sorted(CACHE_SORT_MARKS, arr, cmp_marks_desc, M_SORT);
     if (n == 0)
     {
         printf("No records to sort.\n");
         return;
     }
-    if (opt == 1) qsort(arr, n, sizeof(Student), cmp_roll_asc);
-    else qsort(arr, n, sizeof(Student), cmp_marks_desc);
     print_table_header();
     for (int i = 0; i < n; ++i) print_student_row(&arr[i]);
-    printf("+--------+----------------------+----------+---------+-----+\n");
+    print_table_footer();
 }
 
 void top_n_terminal()
@@ -413,61 +492,386 @@ void top_n_terminal()
         return;
     }
     Student arr[MAX_STUDENTS];
-    int n = load_students(arr);
+    int n = load_sorted(CACHE_SORT_MARKS, arr, cmp_marks_desc, M_TOP_N);
     if (n == 0)
     {
         printf("No records.\n");
         return;
     }
-    qsort(arr, n, sizeof(Student), cmp_marks_desc);
     printf("Top %d students:\n", N);
     print_table_header();
     for (int i = 0; i < N && i < n; ++i) print_student_row(&arr[i]);
-    printf("+--------+----------------------+----------+---------+-----+\n");
+    print_table_footer();
 }
 
 void statistics_terminal()
 {
-    Student arr[MAX_STUDENTS];
-    int n = load_students(arr);
-    if (n == 0)
+    static StatsReport r;
+    if (cache_get(CACHE_STATISTICS, store_generation(), &r, sizeof(r)) < 0)
+    {
+        static Student arr[MAX_STUDENTS];
+        int n = load_students(arr);
+        unsigned long long t0 = metrics_start();
+        size_t size = stats_report(arr, n, &r);
+        metrics_end(M_STATS, t0, 0);
+        cache_put(CACHE_STATISTICS, loaded_generation, &r, size);
+    }
+    if (r.n == 0)
     {
         printf("No records.\n");
         return;
     }
-    float total = 0;
-    float max = arr[0].marks, min = arr[0].marks;
-    int grade_counts[6] = {0}; // A+,A,B+,B,C, F/others
-    for (int i = 0; i < n; ++i)
-    {
-        float m = arr[i].marks;
-        total += m;
-        if (m > max) max = m;
-        if (m < min) min = m;
-        if (strcmp(arr[i].grade, "A+") == 0) grade_counts[0]++;
-        else if (strcmp(arr[i].grade, "A") == 0) grade_counts[1]++;
-        else if (strcmp(arr[i].grade, "B+") == 0) grade_counts[2]++;
-        else if (strcmp(arr[i].grade, "B") == 0) grade_counts[3]++;
-        else if (strcmp(arr[i].grade, "C") == 0) grade_counts[4]++;
-        else grade_counts[5]++;
-    }
+
     printf("\n--- Statistics ---\n");
-    printf("Total students: %d\n", n);
-    printf("Average marks: %.2f\n", total / n);
-    printf("Max marks: %.2f\n", max);
-    printf("Min marks: %.2f\n", min);
+    printf("Total students: %d\n", r.n);
+    printf("Average marks: %.2f\n", r.total / r.n);
+    printf("Max marks: %.2f\n", r.max);
+    printf("Min marks: %.2f\n", r.min);
+    printf("Median marks: %.2f\n", r.median);
+    printf("Std deviation: %.2f\n", r.stddev);
+    printf("Percentiles: P10 %.2f | P25 %.2f | P75 %.2f | P90 %.2f\n", r.p10, r.p25, r.p75, r.p90);
     printf("Grade distribution:\n");
     printf("A+: %d\nA: %d\nB+: %d\nB: %d\nC: %d\nF/others: %d\n",
-           grade_counts[0], grade_counts[1], grade_counts[2],
-           grade_counts[3], grade_counts[4], grade_counts[5]);
+           r.grade_counts[0], r.grade_counts[1], r.grade_counts[2],
+           r.grade_counts[3], r.grade_counts[4], r.grade_counts[5]);
+
+    printf("\nBy section:\n");
+    printf("%-9s %5s %7s %7s %7s %4s %4s %4s %4s %4s %4s\n",
+           "Section", "Count", "Avg", "Min", "Max", "A+", "A", "B+", "B", "C", "F");
+    for (int i = 0; i < r.ngroups; ++i)
+    {
+        SectionStats *g = &r.groups[i];
+        printf("%-9s %5d %7.2f %7.2f %7.2f %4d %4d %4d %4d %4d %4d\n",
+               g->section, g->count, g->total / g->count, g->min, g->max,
+               g->grade_counts[0], g->grade_counts[1], g->grade_counts[2],
+               g->grade_counts[3], g->grade_counts[4], g->grade_counts[5]);
+    }
 }
 
-/* Count students */
-void count_students_terminal()
+void bulk_curve_terminal()
 {
+    if (strcmp(current_role, "admin") != 0)
+    {
+        printf("Permission denied. Only admin can change marks.\n");
+        return;
+    }
+    char section[10];
+    float factor = 1, offset = 0;
+    printf("\n--- Curve Marks (admin) ---\n");
+    printf("New marks = min(100, marks * factor + offset); grades are recalculated.\n");
+    printf("Section (leave blank for all): ");
+    read_line(section, sizeof(section));
+    printf("Factor (blank = 1): ");
+    if (read_float_with_default(&factor, 1, 1) == -1)
+    {
+        printf("Invalid factor.\n");
+        return;
+    }
+    printf("Offset (blank = 0): ");
+    if (read_float_with_default(&offset, 1, 0) == -1)
+    {
+        printf("Invalid offset.\n");
+        return;
+    }
     Student arr[MAX_STUDENTS];
     int n = load_students(arr);
-    printf("Total students: %d\n", n);
+    int changed = apply_curve(arr, n, section, factor, offset);
+    if (changed == 0)
+    {
+        printf("No matching records.\n");
+        return;
+    }
+    if (report_save(save_all_students(arr, n))) printf("%d record(s) updated.\n", changed);
+}
+
+void rank_terminal()
+{
+    char buf[128];
+    printf("\n--- Rank by Roll ---\nEnter Roll: ");
+    read_line(buf, sizeof(buf));
+    int roll;
+    if (sscanf(buf, "%d", &roll) != 1)
+    {
+        printf("Invalid input.\n");
+        return;
+    }
+    RankInfo r;
+    int found = rank_of_roll(roll, &r);
+    if (found < 0) printf("Error: could not load records.\n");
+    else if (!found) printf("Record not found.\n");
+    else
+        printf("%s (roll %d) with %.2f marks ranks %d of %d (above %.1f%% of students).\n",
+               r.rec.name, roll, r.rec.marks, r.rank, r.n, 100.0 * r.below / r.n);
+}
+
+// Moves several students to one section in a single transaction: all of
+// them are saved with one write, or none are.
+void resection_terminal()
+{
+    if (strcmp(current_role, "admin") != 0)
+    {
+        printf("Permission denied. Only admin can update records.\n");
+        return;
+    }
+    char line[256], section[10];
+    printf("\n--- Move Students to a Section (admin) ---\n");
+    printf("Rolls (separated by spaces): ");
+    read_line(line, sizeof(line));
+    printf("New section: ");
+    read_line(section, sizeof(section));
+    if (section[0] == '\0')
+    {
+        printf("Section cannot be blank.\n");
+        return;
+    }
+    Txn *t = txn_begin();
+    if (!t)
+    {
+        printf("Error: could not load records.\n");
+        return;
+    }
+    int moved = 0, missing = 0;
+    int seen[sizeof(line) / 2], nseen = 0; // a roll takes a digit and a separator
+    char *p = line, *end;
+    for (;;)
+    {
+        long roll = strtol(p, &end, 10);
+        if (end == p) break;
+        p = end;
+        int dup = 0;
+        for (int k = 0; k < nseen && !dup; ++k) dup = seen[k] == (int)roll;
+        if (dup) continue; // entered twice: move it once
+        seen[nseen++] = (int)roll;
+        const Student *cur = txn_find(t, (int)roll);
+        if (!cur)
+        {
+            printf("Roll %ld not found.\n", roll);
+            missing++;
+            continue;
+        }
+        Student s = *cur;
+        memset(s.section, 0, sizeof(s.section));
+        snprintf(s.section, sizeof(s.section), "%s", section);
+        txn_update(t, &s);
+        moved++;
+    }
+    if (moved > 0 && missing > 0)
+    {
+        printf("Move the other %d record(s) anyway? (y/N): ", moved);
+        read_line(line, sizeof(line));
+        if (line[0] != 'y' && line[0] != 'Y') moved = 0;
+    }
+    if (moved == 0)
+    {
+        txn_abort(t);
+        printf("No records moved.\n");
+        return;
+    }
+    if (report_save(txn_commit(t))) printf("%d record(s) moved to section %s.\n", moved, section);
+}
+
+/* Count students */
+void count_students_terminal()
+{
+    printf("Total students: %d\n", count_students());
+}
+
+
+void query_terminal()
+{
+    char text[256], err[128];
+    Query q;
+    printf("\n--- Query Records ---\n");
+    printf("Fields: roll name section marks grade; operators: == != < <= > >=\n");
+    printf("Example: section == \"A\" && marks >= 75 order by marks desc limit 20\n");
+    printf("Query (blank for all): ");
+    read_line(text, sizeof(text));
+    if (!compile_query(text, &q, err, sizeof(err)))
+    {
+        printf("Query error: %s\n", err);
+        return;
+    }
+    Partition parts[MAX_PARTITIONS];
+    int all_terms = 0;
+    if (load_catalog(parts, MAX_PARTITIONS) > 0)
+    {
+        printf("Include archived terms? (y/N): ");
+        read_line(err, sizeof(err));
+        all_terms = err[0] == 'y' || err[0] == 'Y';
+    }
+    static Student arr[MAX_STUDENTS];
+    Student *res = arr;
+    int m, pruned = 0;
+    char key[CACHE_KEY_LEN];
+    int keyed = query_key(&q, key, sizeof(key));
+    long got;
+    if (all_terms) res = query_all_terms(&q, &m, &pruned);
+    else if (keyed && (got = cache_get(key, store_generation(), arr, sizeof(arr))) >= 0)
+        m = (int)(got / sizeof(Student));
+    else
+    {
+        m = run_query(arr, load_students(arr), &q);
+        if (keyed) cache_put(key, loaded_generation, arr, sizeof(Student) * m);
+    }
+    if (m == 0)
+    {
+        printf("No matching records.\n");
+    }
+    else
+    {
+        print_table_header();
+        for (int i = 0; i < m; ++i) print_student_row(&res[i]);
+        print_table_footer();
+        printf("Matching records: %d\n", m);
+    }
+    if (all_terms) printf("Archived terms skipped by the catalog: %d\n", pruned);
+    if (res != arr) free(res);
+}
+
+// Moves the current roster into a read-only archived term, starting an
+// empty current term.
+void archive_term_terminal()
+{
+    char name[64];
+    Partition parts[MAX_PARTITIONS];
+    int np = load_catalog(parts, MAX_PARTITIONS);
+    printf("\n--- Archive Current Term ---\n");
+    for (int i = 0; i < np; ++i) printf("  %-20s %6d records\n", parts[i].name, parts[i].count);
+    printf("Name for the term being archived (e.g. 2024-fall): ");
+    if (!read_line(name, sizeof(name)) || name[0] == '\0') return;
+    printf("This moves all %d current records into \"%s\" and empties the roster. Continue? (y/N): ",
+           count_students(), name);
+    char buf[16];
+    read_line(buf, sizeof(buf));
+    if (buf[0] != 'y' && buf[0] != 'Y') return;
+    int r = archive_term(name);
+    if (r == STORE_OK) printf("Term archived. The current roster is now empty.\n");
+    else if (r == STORE_DUPLICATE) printf("A term with that name already exists.\n");
+    else if (r == STORE_CONFLICT) printf("Records were changed by another user. Please retry.\n");
+    else printf("Could not archive (no records, or invalid name).\n");
+}
+
+// Shows the records of a snapshot matching a query. which is a snapshot
+// name or a local time "YYYY-MM-DD [HH:MM]", meaning the newest snapshot
+// taken by then; a snapshot named like a date is taken by its name.
+static void query_snapshot_terminal(const char *which)
+{
+    static Snapshot all[MAX_SNAPSHOTS];
+    Snapshot snap;
+    struct tm tm = {0};
+    char text[256], err[128];
+    Query q;
+    int ns = snapshot_list(all, MAX_SNAPSHOTS), named = 0;
+    for (int i = 0; i < ns && !named; ++i)
+    {
+        if (strcmp(all[i].name, which) == 0)
+        {
+            snap = all[i];
+            named = 1;
+        }
+    }
+    if (!named && sscanf(which, "%d-%d-%d %d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min) >= 3)
+    {
+        if (!strchr(which, ':'))
+        {
+            tm.tm_hour = 23; // the whole day
+            tm.tm_min = 59;
+            tm.tm_sec = 59;
+        }
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+        tm.tm_isdst = -1;
+        if (!snapshot_as_of((long long)mktime(&tm), &snap))
+        {
+            printf("No snapshot was taken by then.\n");
+            return;
+        }
+    }
+    else if (!named)
+    {
+        snprintf(snap.name, sizeof(snap.name), "%.*s", SNAPSHOT_NAME_LEN - 1, which);
+    }
+    int n;
+    Student *arr = snapshot_load(snap.name, &n);
+    if (!arr)
+    {
+        printf("Snapshot %s not found or empty.\n", snap.name);
+        return;
+    }
+    printf("Query on snapshot %s (blank for all): ", snap.name);
+    read_line(text, sizeof(text));
+    if (!compile_query(text, &q, err, sizeof(err)))
+    {
+        printf("Query error: %s\n", err);
+        free(arr);
+        return;
+    }
+    int m = run_query(arr, n, &q);
+    if (m == 0)
+    {
+        printf("No matching records.\n");
+    }
+    else
+    {
+        print_table_header();
+        for (int i = 0; i < m; ++i) print_student_row(&arr[i]);
+        print_table_footer();
+        printf("Matching records: %d of %d\n", m, n);
+    }
+    free(arr);
+}
+
+// Takes, lists, queries and deletes point-in-time snapshots of the roster.
+void snapshots_terminal()
+{
+    static Snapshot all[MAX_SNAPSHOTS];
+    char buf[64];
+    printf("\n--- Snapshots ---\n");
+    printf("1. Take a snapshot\n2. List snapshots\n3. Query a snapshot\n4. Delete a snapshot\nChoose option: ");
+    read_line(buf, sizeof(buf));
+    int opt = atoi(buf), r;
+    Snapshot snap;
+    switch (opt)
+    {
+    case 1:
+        printf("Name (blank for the current time): ");
+        read_line(buf, sizeof(buf));
+        r = snapshot_create(buf, &snap);
+        if (r == STORE_OK) printf("Snapshot %s taken: %d records.\n", snap.name, snap.records);
+        else if (r == STORE_DUPLICATE) printf("A snapshot with that name already exists.\n");
+        else printf("Could not take the snapshot.\n");
+        break;
+    case 2:
+    {
+        int n = snapshot_list(all, MAX_SNAPSHOTS);
+        if (n == 0) printf("No snapshots.\n");
+        for (int i = 0; i < n; ++i)
+        {
+            time_t t = (time_t)all[i].taken;
+            strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime(&t));
+            printf("  %-24s %s %8d records\n", all[i].name, buf, all[i].records);
+        }
+        break;
+    }
+    case 3:
+        printf("Snapshot name, or date as YYYY-MM-DD [HH:MM]: ");
+        if (read_line(buf, sizeof(buf)) && buf[0] != '\0') query_snapshot_terminal(buf);
+        break;
+    case 4:
+        printf("Snapshot name: ");
+        read_line(buf, sizeof(buf));
+        if (snapshot_drop(buf) == STORE_OK) printf("Snapshot deleted.\n");
+        else printf("No such snapshot.\n");
+        break;
+    default:
+        printf("Invalid choice.\n");
+    }
+}
+
+void performance_stats_terminal()
+{
+    printf("\n--- Performance Stats (this session) ---\n");
+    metrics_print(stdout);
 }
 
 /* ---------------- Main Menu & Flow ---------------- */
@@ -489,6 +893,13 @@ void show_main_menu()
             printf("7. Top N students\n");
             printf("8. Statistics\n");
             printf("9. Count students\n");
+            printf("10. Curve marks (admin)\n");
+            printf("11. Query records\n");
+            printf("12. Rank of a student\n");
+            printf("13. Performance stats\n");
+            printf("14. Archive current term (admin)\n");
+            printf("15. Move students to a section (admin)\n");
+            printf("16. Snapshots (admin)\n");
             printf("0. Exit\n");
         }
         else     // teacher
@@ -497,6 +908,9 @@ void show_main_menu()
             printf("5. Top N students\n");
             printf("6. Statistics\n");
             printf("7. Count students\n");
+            printf("8. Query records\n");
+            printf("9. Rank of a student\n");
+            printf("10. Performance stats\n");
             printf("0. Exit\n");
         }
         printf("Choose option: ");
@@ -535,6 +949,27 @@ void show_main_menu()
             case 9:
                 count_students_terminal();
                 break;
+            case 10:
+                bulk_curve_terminal();
+                break;
+            case 11:
+                query_terminal();
+                break;
+            case 12:
+                rank_terminal();
+                break;
+            case 13:
+                performance_stats_terminal();
+                break;
+            case 14:
+                archive_term_terminal();
+                break;
+            case 15:
+                resection_terminal();
+                break;
+            case 16:
+                snapshots_terminal();
+                break;
             case 0:
                 printf("Goodbye.\n");
                 return;
@@ -567,6 +1002,15 @@ void show_main_menu()
             case 7:
                 count_students_terminal();
                 break;
+            case 8:
+                query_terminal();
+                break;
+            case 9:
+                rank_terminal();
+                break;
+            case 10:
+                performance_stats_terminal();
+                break;
             case 0:
                 printf("Goodbye.\n");
                 return;
@@ -580,6 +1024,9 @@ void show_main_menu()
 int main()
 {
     printf("Student Management System (Terminal)\n");
+    plain_output = !isatty(1);
+    load_grade_policy();
+    metrics_init();
     // simple login prompt: allow 3 attempts
     int attempts = 0;
     while (attempts < 3)
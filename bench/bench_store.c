@@ -0,0 +1,546 @@
+// bench_store.c
+// Benchmarks libstudentstore on a synthetic roster.
+// Build and run (from the repository root):
+//   make bench
+//   ./bench_store -n 100000 --json bench.json
+//   ./bench_store -n 100000 --baseline bench.json
+//
+// The roster is generated in a scratch directory (default bench_data/) so
+// the real student.txt is never touched. Every core operation is timed
+// individually; the report gives throughput, latency percentiles, peak RSS
+// and bytes read/written, as a table and optionally as JSON. With
+// --baseline, each operation's throughput is compared to a saved JSON run
+// and the exit status is 1 if any operation regressed past --tolerance.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "../store/student_store.h"
+
+#define MAX_OPS 16
+
+typedef struct
+{
+    const char *name;
+    int iters;
+    double *lat_ns;   // one sample per iteration
+    double total_ns;
+    long long bytes_read, bytes_written;
+    double ops_per_sec, p50, p95, p99, max; // latencies in microseconds
+} OpResult;
+
+static OpResult results[MAX_OPS];
+static int nresults = 0;
+
+/* ---------------- Measurement helpers ---------------- */
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Bytes this process has read/written so far (Linux /proc/self/io).
+static void io_counters(long long *rd, long long *wr)
+{
+    char line[128];
+    *rd = *wr = 0;
+    FILE *fp = fopen("/proc/self/io", "r");
+    if (!fp) return;
+    while (fgets(line, sizeof(line), fp))
+    {
+        sscanf(line, "rchar: %lld", rd);
+        sscanf(line, "wchar: %lld", wr);
+    }
+    fclose(fp);
+}
+
+static long peak_rss_kb(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static OpResult *begin_op(const char *name, int iters)
+{
+    OpResult *r = &results[nresults++];
+    memset(r, 0, sizeof(*r));
+    r->name = name;
+    r->iters = iters;
+    r->lat_ns = calloc(iters, sizeof(double));
+    io_counters(&r->bytes_read, &r->bytes_written);
+    return r;
+}
+
+static void end_op(OpResult *r)
+{
+    long long rd, wr;
+    io_counters(&rd, &wr);
+    r->bytes_read = rd - r->bytes_read;
+    r->bytes_written = wr - r->bytes_written;
+    for (int i = 0; i < r->iters; ++i) r->total_ns += r->lat_ns[i];
+    qsort(r->lat_ns, r->iters, sizeof(double), cmp_double);
+    r->ops_per_sec = r->total_ns > 0 ? r->iters / (r->total_ns / 1e9) : 0;
+    r->p50 = r->lat_ns[(r->iters - 1) * 50 / 100] / 1e3;
+    r->p95 = r->lat_ns[(r->iters - 1) * 95 / 100] / 1e3;
+    r->p99 = r->lat_ns[(r->iters - 1) * 99 / 100] / 1e3;
+    r->max = r->lat_ns[r->iters - 1] / 1e3;
+    free(r->lat_ns);
+    r->lat_ns = NULL;
+}
+
+// Scales an iteration count down for big rosters, within [lo, hi].
+static int scaled(double work, int n, int lo, int hi)
+{
+    double it = work / (n > 0 ? n : 1);
+    return it < lo ? lo : it > hi ? hi : (int)it;
+}
+
+/* ---------------- Synthetic roster ---------------- */
+
+static unsigned long long rng_state = 88172645463325252ULL;
+
+static unsigned int rnd(void)
+{
+    rng_state ^= rng_state << 13; // xorshift64
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (unsigned int)(rng_state >> 16);
+}
+
+static const char *syllables[] = {
+    "an", "ya", "ra", "vi", "sh", "ka", "li", "mo", "ne", "pa", "ti", "su",
+    "de", "jo", "ha", "ri", "el", "ma", "no", "ta", "ar", "is", "on", "ja"
+};
+
+// First and last name of 2-5 syllables each, e.g. "Ravina Shkali".
+static void random_name(char *out, int size)
+{
+    int len = 0;
+    for (int part = 0; part < 2; ++part)
+    {
+        int syl = 2 + rnd() % 4;
+        int start = len;
+        for (int k = 0; k < syl && len < size - 3; ++k)
+        {
+            const char *s = syllables[rnd() % (sizeof(syllables) / sizeof(syllables[0]))];
+            out[len++] = s[0];
+            out[len++] = s[1];
+        }
+        out[start] -= 'a' - 'A';
+        if (part == 0) out[len++] = ' ';
+    }
+    out[len] = '\0';
+}
+
+// Roughly normal marks around 68 (sum of four uniforms), clipped to 0..100.
+static float random_marks(void)
+{
+    float u = 0;
+    for (int k = 0; k < 4; ++k) u += (rnd() % 10001) / 10000.0f;
+    float m = 68 + (u - 2) * 30;
+    m = m < 0 ? 0 : m > 100 ? 100 : m;
+    return (int)(m * 100) / 100.0f;
+}
+
+static void random_student(Student *s, int roll)
+{
+    memset(s, 0, sizeof(*s));
+    s->roll = roll;
+    random_name(s->name, sizeof(s->name));
+    snprintf(s->section, sizeof(s->section), "%c", 'A' + rnd() % 8);
+    s->marks = random_marks();
+    calc_grade_from_marks(s);
+}
+
+// Writes n records with shuffled unique rolls 1..n to FILE_NAME.
+static int generate_roster(int n)
+{
+    int *rolls = malloc(n * sizeof(int));
+    Student *arr = malloc(n * sizeof(Student));
+    if (!rolls || !arr)
+    {
+        free(rolls);
+        free(arr);
+        return 0;
+    }
+    for (int i = 0; i < n; ++i) rolls[i] = i + 1;
+    for (int i = n - 1; i > 0; --i)
+    {
+        int j = rnd() % (i + 1), t = rolls[i];
+        rolls[i] = rolls[j];
+        rolls[j] = t;
+    }
+    for (int i = 0; i < n; ++i) random_student(&arr[i], rolls[i]);
+    remove(FILE_NAME);
+    remove(LOCK_FILE_NAME);
+    free(load_all_students(&(int){0})); // sync loaded_generation with the fresh lock file
+    int ok = save_all_students(arr, n) == STORE_OK;
+    free(rolls);
+    free(arr);
+    return ok;
+}
+
+/* ---------------- Operations ---------------- */
+
+static void run_benchmarks(int n)
+{
+    int count;
+    Student *arr, *copy;
+    OpResult *r;
+    double t;
+
+    r = begin_op("load", scaled(5e7, n, 3, 50));
+    for (int i = 0; i < r->iters; ++i)
+    {
+        t = now_ns();
+        arr = load_all_students(&count);
+        r->lat_ns[i] = now_ns() - t;
+        free(arr);
+    }
+    end_op(r);
+
+    arr = load_all_students(&count);
+    copy = malloc((size_t)count * sizeof(Student));
+
+    r = begin_op("lookup_roll", scaled(2e9, n, 20, 10000));
+    volatile int sink = 0;
+    for (int i = 0; i < r->iters; ++i)
+    {
+        int roll = 1 + rnd() % n;
+        t = now_ns();
+        sink += find_by_roll(arr, count, roll);
+        r->lat_ns[i] = now_ns() - t;
+    }
+    end_op(r);
+
+    r = begin_op("count", 1000);
+    for (int i = 0; i < r->iters; ++i)
+    {
+        t = now_ns();
+        sink += count_students();
+        r->lat_ns[i] = now_ns() - t;
+    }
+    end_op(r);
+
+    // Time to first row of Display all; should not grow with n.
+    r = begin_op("first_page", 1000);
+    for (int i = 0; i < r->iters; ++i)
+    {
+        t = now_ns();
+        PagedReader *pr = pager_open(0);
+        if (pr) sink += pager_get(pr, 0) != NULL;
+        pager_close(pr);
+        r->lat_ns[i] = now_ns() - t;
+    }
+    end_op(r);
+
+    r = begin_op("sort_roll", scaled(5e7, n, 3, 50));
+    for (int i = 0; i < r->iters; ++i)
+    {
+        memcpy(copy, arr, (size_t)count * sizeof(Student));
+        t = now_ns();
+        qsort(copy, count, sizeof(Student), cmp_roll_asc);
+        r->lat_ns[i] = now_ns() - t;
+    }
+    end_op(r);
+
+    r = begin_op("sort_marks", scaled(5e7, n, 3, 50));
+    for (int i = 0; i < r->iters; ++i)
+    {
+        memcpy(copy, arr, (size_t)count * sizeof(Student));
+        t = now_ns();
+        qsort(copy, count, sizeof(Student), cmp_marks_desc);
+        r->lat_ns[i] = now_ns() - t;
+    }
+    end_op(r);
+
+    r = begin_op("top_10", scaled(5e7, n, 3, 50));
+    for (int i = 0; i < r->iters; ++i)
+    {
+        memcpy(copy, arr, (size_t)count * sizeof(Student));
+        t = now_ns();
+        qsort(copy, count, sizeof(Student), cmp_marks_desc); // what top_n_terminal does
+        sink += copy[0].roll;
+        r->lat_ns[i] = now_ns() - t;
+    }
+    end_op(r);
+
+    static MarksHistogram hist;
+    static SectionStats groups[MAX_SECTIONS];
+    r = begin_op("statistics", scaled(5e7, n, 3, 50));
+    for (int i = 0; i < r->iters; ++i)
+    {
+        t = now_ns();
+        hist_build(&hist, arr, count);
+        sink += (int)hist_median(&hist) + group_by_section(arr, count, groups);
+        r->lat_ns[i] = now_ns() - t;
+    }
+    end_op(r);
+
+    // A repeated Statistics request while the roster is unchanged: the
+    // generation check plus a copy out of the result cache.
+    static StatsReport report;
+    cache_put(CACHE_STATISTICS, loaded_generation, &report, stats_report(arr, count, &report));
+    r = begin_op("stats_cached", 10000);
+    for (int i = 0; i < r->iters; ++i)
+    {
+        t = now_ns();
+        sink += cache_get(CACHE_STATISTICS, store_generation(), &report, sizeof(report)) >= 0;
+        r->lat_ns[i] = now_ns() - t;
+    }
+    end_op(r);
+
+    // Archived-term reads: a full scan decodes every block, a roll lookup
+    // should inflate just one.
+    Query all, one;
+    char err[64], text[32];
+    compile_query("marks >= 0", &all, err, sizeof(err));
+    archive_write("bench.sma", arr, count, ARCHIVE_LEVEL);
+    r = begin_op("archive_scan", scaled(5e7, n, 3, 50));
+    for (int i = 0; i < r->iters; ++i)
+    {
+        Student *hits = NULL;
+        int nhits = 0, cap = 0;
+        t = now_ns();
+        ArchiveReader *a = archive_open("bench.sma");
+        if (a) sink += archive_query(a, &all, &hits, &nhits, &cap);
+        archive_close(a);
+        r->lat_ns[i] = now_ns() - t;
+        free(hits);
+    }
+    end_op(r);
+
+    r = begin_op("archive_lookup", 1000);
+    for (int i = 0; i < r->iters; ++i)
+    {
+        Student *hits = NULL;
+        int nhits = 0, cap = 0;
+        snprintf(text, sizeof(text), "roll == %d", 1 + rnd() % n);
+        compile_query(text, &one, err, sizeof(err));
+        t = now_ns();
+        ArchiveReader *a = archive_open("bench.sma");
+        if (a) sink += archive_query(a, &one, &hits, &nhits, &cap);
+        archive_close(a);
+        r->lat_ns[i] = now_ns() - t;
+        free(hits);
+    }
+    end_op(r);
+    remove("bench.sma");
+    free(copy);
+    free(arr);
+
+    int next_roll = n + 1;
+    r = begin_op("insert", scaled(2e7, n, 5, 200));
+    for (int i = 0; i < r->iters; ++i)
+    {
+        Student s;
+        random_student(&s, next_roll++);
+        t = now_ns();
+        insert_student(&s);
+        r->lat_ns[i] = now_ns() - t;
+    }
+    end_op(r);
+
+    // update and delete follow the front ends: load, change one record, save all
+    r = begin_op("update", scaled(2e7, n, 3, 100));
+    for (int i = 0; i < r->iters; ++i)
+    {
+        int roll = 1 + rnd() % n;
+        t = now_ns();
+        arr = load_all_students(&count);
+        int idx = find_by_roll(arr, count, roll);
+        if (idx >= 0)
+        {
+            arr[idx].marks = random_marks();
+            calc_grade_from_marks(&arr[idx]);
+        }
+        save_all_students(arr, count);
+        r->lat_ns[i] = now_ns() - t;
+        free(arr);
+    }
+    end_op(r);
+
+    // Ten updates in one transaction: one load and one save in total.
+    r = begin_op("txn_10_updates", scaled(2e7, n, 3, 100));
+    for (int i = 0; i < r->iters; ++i)
+    {
+        t = now_ns();
+        Txn *txn = txn_begin();
+        for (int k = 0; txn && k < 10; ++k)
+        {
+            const Student *cur = txn_find(txn, 1 + rnd() % n);
+            if (!cur) continue;
+            Student s = *cur;
+            s.marks = random_marks();
+            calc_grade_from_marks(&s);
+            txn_update(txn, &s);
+        }
+        if (txn) txn_commit(txn);
+        r->lat_ns[i] = now_ns() - t;
+    }
+    end_op(r);
+
+    r = begin_op("delete", scaled(2e7, n, 3, 100));
+    for (int i = 0; i < r->iters; ++i)
+    {
+        int roll = n + 1 + i; // delete what the insert step added
+        t = now_ns();
+        arr = load_all_students(&count);
+        int idx = find_by_roll(arr, count, roll);
+        if (idx >= 0)
+        {
+            for (int k = idx; k < count - 1; ++k) arr[k] = arr[k+1];
+            count--;
+        }
+        save_all_students(arr, count);
+        r->lat_ns[i] = now_ns() - t;
+        free(arr);
+    }
+    end_op(r);
+    (void)sink;
+}
+
+/* ---------------- Reporting ---------------- */
+
+static void print_table(int n)
+{
+    printf("Roster: %d records, peak RSS %ld KB\n", n, peak_rss_kb());
+    printf("%-12s %7s %12s %10s %10s %10s %10s %12s %12s\n",
+           "operation", "iters", "ops/sec", "p50 us", "p95 us", "p99 us", "max us", "bytes read", "bytes wrtn");
+    for (int i = 0; i < nresults; ++i)
+    {
+        OpResult *r = &results[i];
+        printf("%-12s %7d %12.1f %10.1f %10.1f %10.1f %10.1f %12lld %12lld\n",
+               r->name, r->iters, r->ops_per_sec, r->p50, r->p95, r->p99, r->max,
+               r->bytes_read, r->bytes_written);
+    }
+}
+
+// One operation per line so compare_baseline can read it back with sscanf.
+static int write_json(const char *path, int n)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp) return 0;
+    fprintf(fp, "{\n\"records\": %d,\n\"peak_rss_kb\": %ld,\n\"operations\": [\n", n, peak_rss_kb());
+    for (int i = 0; i < nresults; ++i)
+    {
+        OpResult *r = &results[i];
+        fprintf(fp, "{\"op\": \"%s\", \"iters\": %d, \"ops_per_sec\": %.3f, \"p50_us\": %.3f, "
+                "\"p95_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f, \"bytes_read\": %lld, "
+                "\"bytes_written\": %lld}%s\n",
+                r->name, r->iters, r->ops_per_sec, r->p50, r->p95, r->p99, r->max,
+                r->bytes_read, r->bytes_written, i + 1 < nresults ? "," : "");
+    }
+    fprintf(fp, "]\n}\n");
+    fclose(fp);
+    return 1;
+}
+
+// Returns the number of operations slower than baseline by more than tolerance.
+static int compare_baseline(const char *path, double tolerance)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "Cannot open baseline %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    char line[512], name[32];
+    double base;
+    int regressions = 0;
+    printf("\nAgainst baseline %s (tolerance %.0f%%):\n", path, tolerance * 100);
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (sscanf(line, "{\"op\": \"%31[^\"]\", \"iters\": %*d, \"ops_per_sec\": %lf", name, &base) != 2) continue;
+        for (int i = 0; i < nresults; ++i)
+        {
+            if (strcmp(results[i].name, name) != 0) continue;
+            double ratio = base > 0 ? results[i].ops_per_sec / base : 1;
+            int slow = ratio < 1 - tolerance;
+            regressions += slow;
+            printf("%-12s %12.1f -> %12.1f ops/sec  (%+.1f%%)%s\n", name, base,
+                   results[i].ops_per_sec, (ratio - 1) * 100, slow ? "  REGRESSION" : "");
+        }
+    }
+    fclose(fp);
+    return regressions;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-n records] [--seed N] [--dir path] [--json out.json]\n"
+            "          [--baseline base.json] [--tolerance 0.10] [--generate-only]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    int n = 100000, generate_only = 0;
+    const char *dir = "bench_data", *json = NULL, *baseline = NULL;
+    double tolerance = 0.10;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) n = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) rng_state = strtoull(argv[++i], NULL, 10) | 1;
+        else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) dir = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baseline = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "--generate-only") == 0) generate_only = 1;
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (n <= 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof(cwd))) return 1;
+    mkdir(dir, 0755);
+    if (chdir(dir) != 0)
+    {
+        fprintf(stderr, "Cannot use directory %s: %s\n", dir, strerror(errno));
+        return 1;
+    }
+    build_grade_table();
+
+    double t = now_ns();
+    if (!generate_roster(n))
+    {
+        fprintf(stderr, "Cannot generate %d records\n", n);
+        return 1;
+    }
+    printf("Generated %d records in %s/%s (%.1f ms)\n", n, dir, FILE_NAME, (now_ns() - t) / 1e6);
+    if (generate_only) return 0;
+
+    run_benchmarks(n);
+    if (chdir(cwd) != 0) return 1;
+    print_table(n);
+    if (json && !write_json(json, n)) fprintf(stderr, "Cannot write %s\n", json);
+    if (baseline)
+    {
+        int regressions = compare_baseline(baseline, tolerance);
+        if (regressions != 0) return 1;
+    }
+    return 0;
+}
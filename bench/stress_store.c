@@ -0,0 +1,936 @@
+// stress_store.c
+// Differential stress test of libstudentstore against a reference model.
+// Build and run (from the repository root):
+//   make stress
+//   ./stress_store -n 1000000 --seed 7
+//   ./stress_store -n 100000 --crash 20     also crash every 20th write
+//
+// Random sequences of inserts, updates, deletes, transactions, lookups,
+// queries, sorts, statistics, paged reads, ranks and snapshots run against
+// the store and against a model of how the front ends worked before the
+// store grew indexes and caches: the whole roster is read from its own file
+// for every operation and rewritten after every change, rolls are found by
+// a linear scan (first match wins), deletes shift the rest down, sorts and
+// queries are a filter plus qsort, and grades come from a chain of
+// comparisons against grade_bounds. The answers are compared after every
+// step, and the store's file against the model every --verify steps
+// (default 1). Each snapshot step first checks that the previous snapshot
+// still holds the roster it was taken from.
+//
+// With --crash N every Nth write runs in a forked child that exits at one
+// of the store's crash points (see CRASH_POINT in store/student_store.h).
+// The file must then hold the roster from before or after that write, the
+// generation must have moved if the roster did, and the change stream must
+// still read back without gaps. Everything runs in a scratch directory
+// (default stress_data/). The report gives ops/sec for the store and the
+// model per operation; the store fsyncs every rewrite and the model does
+// not, so update and delete rates mostly show the price of durability.
+// The first mismatch stops the run with exit status 1 and the step and
+// seed that reproduce it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../store/student_store.h"
+
+#define MODEL_FILE_NAME "reference.txt"
+#define MAX_SUB 8         // changes in one txn_batch step
+#define ROSTER_LIMIT (MAX_STUDENTS - MAX_SUB) // load_students reads at most MAX_STUDENTS
+#define QUERY_POOL 16     // recent queries, so repeats hit the result cache
+#define SNAPSHOT_NAME "stress"
+
+enum
+{
+    S_INSERT, S_APPEND, S_UPDATE, S_DELETE, S_TXN, // writes
+    S_LOOKUP, S_QUERY, S_SORT_MARKS, S_SORT_ROLL, S_STATS, S_PAGE, S_COUNT, S_SNAPSHOT, S_RANK,
+    S_KINDS
+};
+
+static const char *step_names[S_KINDS] = {
+    "insert", "append_dup", "update", "delete", "txn_batch",
+    "lookup", "query", "sort_marks", "sort_roll", "statistics", "page", "count", "snapshot", "rank"
+};
+
+static const int step_weights[S_KINDS] = { 14, 1, 10, 8, 4, 8, 14, 6, 3, 6, 6, 3, 1, 6 };
+
+typedef struct
+{
+    int kind;
+    int roll;                 // delete, lookup, rank
+    Student rec;              // insert, append_dup, update
+    int nsub;                 // txn_batch: S_INSERT, S_UPDATE or S_DELETE each
+    int sub_kind[MAX_SUB];
+    Student sub[MAX_SUB];
+    int via_save;             // delete: load, shift and save_all_students instead of a txn
+    int query;                // index into the query pool
+    int page_start;
+} Step;
+
+typedef struct
+{
+    long count;
+    double store_ns, model_ns;
+} StepTiming;
+
+static StepTiming timing[S_KINDS];
+
+static unsigned long long seed = 1;
+static unsigned long long rng_state;
+static long step_no;
+static Step cur;
+static int max_roll, target;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static unsigned int rnd(void)
+{
+    rng_state ^= rng_state << 13; // xorshift64
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (unsigned int)(rng_state >> 16);
+}
+
+static void describe(const Step *s, char *out, int size)
+{
+    int len = snprintf(out, size, "%s", step_names[s->kind]);
+    if (s->kind == S_INSERT || s->kind == S_APPEND || s->kind == S_UPDATE)
+        snprintf(out + len, size - len, " roll %d marks %.2f", s->rec.roll, s->rec.marks);
+    else if (s->kind == S_DELETE || s->kind == S_LOOKUP || s->kind == S_RANK)
+        snprintf(out + len, size - len, " roll %d%s", s->roll, s->via_save ? " (save)" : "");
+    else if (s->kind == S_TXN)
+        for (int k = 0; k < s->nsub && len < size; ++k)
+            len += snprintf(out + len, size - len, " %s:%d", step_names[s->sub_kind[k]], s->sub[k].roll);
+}
+
+static void fail(const char *fmt, ...)
+{
+    char what[512];
+    describe(&cur, what, sizeof(what));
+    fflush(stdout);
+    fprintf(stderr, "MISMATCH at step %ld (%s): ", step_no, what);
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fprintf(stderr, "\nReplay with --seed %llu -n %ld\n", seed, step_no);
+    exit(1);
+}
+
+static int same_student(const Student *a, const Student *b)
+{
+    return a->roll == b->roll && a->marks == b->marks && strcmp(a->name, b->name) == 0 &&
+           strcmp(a->section, b->section) == 0 && strcmp(a->grade, b->grade) == 0;
+}
+
+static void expect_rows(const char *what, const Student got[], int ngot, const Student want[], int nwant)
+{
+    if (ngot != nwant) fail("%s: %d rows, model has %d", what, ngot, nwant);
+    for (int i = 0; i < ngot; ++i)
+        if (!same_student(&got[i], &want[i]))
+            fail("%s: row %d is roll %d (%s, %.2f), model has roll %d (%s, %.2f)", what, i,
+                 got[i].roll, got[i].name, got[i].marks, want[i].roll, want[i].name, want[i].marks);
+}
+
+/* ---------------- Reference model ---------------- */
+
+static Student model[MAX_STUDENTS];
+static int model_n;
+static Student snap_model[MAX_STUDENTS]; // the model when SNAPSHOT_NAME was taken
+static int snap_n = -1;                  // -1 before the first snapshot
+
+static void model_load(void)
+{
+    FILE *fp = fopen(MODEL_FILE_NAME, "rb");
+    model_n = 0;
+    if (!fp) return;
+    model_n = (int)fread(model, sizeof(Student), MAX_STUDENTS, fp);
+    fclose(fp);
+}
+
+static void model_save(void)
+{
+    FILE *fp = fopen(MODEL_FILE_NAME, "wb");
+    if (!fp || fwrite(model, sizeof(Student), model_n, fp) != (size_t)model_n)
+    {
+        fprintf(stderr, "Cannot write %s\n", MODEL_FILE_NAME);
+        exit(1);
+    }
+    fclose(fp);
+}
+
+static const char *ref_grade(float marks)
+{
+    if (marks >= grade_bounds[0]) return "A+";
+    else if (marks >= grade_bounds[1]) return "A";
+    else if (marks >= grade_bounds[2]) return "B+";
+    else if (marks >= grade_bounds[3]) return "B";
+    else if (marks >= grade_bounds[4]) return "C";
+    return "F";
+}
+
+static int ref_grade_index(const char *g)
+{
+    for (int k = 0; k < GRADE_F; ++k)
+        if (strcmp(g, grade_names[k]) == 0) return k;
+    return GRADE_F;
+}
+
+static int ref_find(const Student arr[], int n, int roll)
+{
+    for (int i = 0; i < n; ++i)
+        if (arr[i].roll == roll) return i;
+    return -1;
+}
+
+// The model's side of a write on arr[0..*n); one result code per change
+// (and for txn_batch the commit's last). Returns whether arr changed.
+static int ref_write(const Step *s, Student arr[], int *n, int res[])
+{
+    int changed = 0, i;
+    switch (s->kind)
+    {
+    case S_INSERT:
+        res[0] = ref_find(arr, *n, s->rec.roll) >= 0 ? STORE_DUPLICATE : STORE_OK;
+        if (res[0] == STORE_OK) arr[(*n)++] = s->rec;
+        return res[0] == STORE_OK;
+    case S_APPEND:
+        arr[(*n)++] = s->rec;
+        res[0] = STORE_OK;
+        return 1;
+    case S_UPDATE:
+        i = ref_find(arr, *n, s->rec.roll);
+        res[0] = i < 0 ? STORE_ERROR : STORE_OK;
+        if (i >= 0) arr[i] = s->rec;
+        return i >= 0;
+    case S_DELETE:
+        i = ref_find(arr, *n, s->roll);
+        res[0] = i < 0 ? STORE_ERROR : STORE_OK;
+        if (i < 0) return 0;
+        for (int j = i; j < *n - 1; ++j) arr[j] = arr[j+1];
+        (*n)--;
+        return 1;
+    default:
+        break;
+    }
+    static Student work[MAX_STUDENTS];
+    int m = *n;
+    memcpy(work, arr, sizeof(Student) * m);
+    for (int k = 0; k < s->nsub; ++k)
+    {
+        Step one = { .kind = s->sub_kind[k], .roll = s->sub[k].roll, .rec = s->sub[k] };
+        changed |= ref_write(&one, work, &m, &res[k]);
+    }
+    res[s->nsub] = STORE_OK;
+    for (i = 0; i < m; ++i)
+        if (!(work[i].marks >= 0 && work[i].marks <= 100)) res[s->nsub] = STORE_INVALID;
+    if (res[s->nsub] != STORE_OK || !changed) return 0;
+    memcpy(arr, work, sizeof(Student) * m);
+    *n = m;
+    return 1;
+}
+
+static int ref_match(const Student *s, const Predicate *pr)
+{
+    double a = 0, b = pr->num;
+    if (pr->field == F_ROLL) a = s->roll;
+    else if (pr->field == F_MARKS) a = s->marks;
+    else
+    {
+        const char *v = pr->field == F_NAME ? s->name : pr->field == F_SECTION ? s->section : s->grade;
+        a = strcmp(v, pr->str);
+        b = 0;
+    }
+    switch (pr->op)
+    {
+    case OP_EQ: return a == b;
+    case OP_NE: return a != b;
+    case OP_LT: return a < b;
+    case OP_LE: return a <= b;
+    case OP_GT: return a > b;
+    default: return a >= b;
+    }
+}
+
+static const Query *ref_order;
+
+static int ref_cmp_order(const void *a, const void *b)
+{
+    const Student *A = a, *B = b;
+    int c;
+    if (ref_order->order_field == F_ROLL) c = A->roll < B->roll ? -1 : A->roll > B->roll;
+    else if (ref_order->order_field == F_MARKS) c = A->marks < B->marks ? -1 : A->marks > B->marks;
+    else if (ref_order->order_field == F_NAME) c = strcmp(A->name, B->name);
+    else if (ref_order->order_field == F_SECTION) c = strcmp(A->section, B->section);
+    else c = strcmp(A->grade, B->grade);
+    return ref_order->order_desc ? -c : c;
+}
+
+static int ref_query(const Query *q, Student out[])
+{
+    int m = 0;
+    for (int i = 0; i < model_n; ++i)
+    {
+        int ok = 1;
+        for (int k = 0; ok && k < q->npreds; ++k) ok = ref_match(&model[i], &q->preds[k]);
+        if (ok) out[m++] = model[i];
+    }
+    if (q->order_field != F_NONE)
+    {
+        ref_order = q;
+        qsort(out, m, sizeof(Student), ref_cmp_order);
+    }
+    return q->limit > 0 && m > q->limit ? q->limit : m;
+}
+
+static int ref_cmp_marks(const void *a, const void *b)
+{
+    float x = ((const Student *)a)->marks, y = ((const Student *)b)->marks;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+static int ref_cmp_roll(const void *a, const void *b)
+{
+    return ((const Student *)a)->roll - ((const Student *)b)->roll;
+}
+
+static int cmp_float(const void *a, const void *b)
+{
+    float x = *(const float *)a, y = *(const float *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Nearest rank, p in whole percent.
+static float ref_percentile(const float sorted[], int n, int p)
+{
+    int k = (p * n + 99) / 100 - 1;
+    return sorted[k < 0 ? 0 : k];
+}
+
+// The statistics report worked out the direct way: sort every mark, count
+// grades by name, one linear search per record for its section.
+static void ref_stats(StatsReport *w)
+{
+    static float marks[MAX_STUDENTS];
+    memset(w, 0, sizeof(*w) - sizeof(w->groups));
+    w->n = model_n;
+    if (model_n == 0) return;
+    for (int i = 0; i < model_n; ++i)
+    {
+        const Student *s = &model[i];
+        marks[i] = s->marks;
+        w->total += s->marks;
+        w->grade_counts[ref_grade_index(s->grade)]++;
+        int g = 0;
+        while (g < w->ngroups && strcmp(w->groups[g].section, s->section) != 0) g++;
+        SectionStats *grp = &w->groups[g];
+        if (g == w->ngroups)
+        {
+            memset(grp, 0, sizeof(*grp));
+            strcpy(grp->section, s->section);
+            grp->min = grp->max = s->marks;
+            w->ngroups++;
+        }
+        grp->count++;
+        grp->total += s->marks;
+        if (s->marks < grp->min) grp->min = s->marks;
+        if (s->marks > grp->max) grp->max = s->marks;
+        grp->grade_counts[ref_grade_index(s->grade)]++;
+    }
+    qsort(marks, model_n, sizeof(float), cmp_float);
+    w->min = marks[0];
+    w->max = marks[model_n - 1];
+    w->median = model_n % 2 ? marks[model_n / 2] : (marks[model_n / 2 - 1] + marks[model_n / 2]) / 2;
+    w->p10 = ref_percentile(marks, model_n, 10);
+    w->p25 = ref_percentile(marks, model_n, 25);
+    w->p75 = ref_percentile(marks, model_n, 75);
+    w->p90 = ref_percentile(marks, model_n, 90);
+    double mean = w->total / (double)model_n, var = 0;
+    for (int i = 0; i < model_n; ++i) var += (marks[i] - mean) * (marks[i] - mean);
+    w->stddev = sqrt(var / model_n);
+}
+
+/* ---------------- Store side ----------------
+ * Each read goes the way the front ends go: result cache first, then a
+ * load and the store's own sort, query or statistics code.
+ */
+
+static void store_write(const Step *s, int res[])
+{
+    if (s->kind == S_INSERT) res[0] = insert_student(&s->rec);
+    else if (s->kind == S_APPEND) res[0] = append_student(&s->rec);
+    else if (s->kind == S_DELETE && s->via_save)
+    {
+        int n;
+        Student *arr = load_all_students(&n);
+        int i = find_by_roll(arr, n, s->roll);
+        if (i >= 0)
+        {
+            memmove(&arr[i], &arr[i+1], sizeof(Student) * (n - i - 1));
+            res[0] = save_all_students(arr, n - 1);
+        }
+        else res[0] = STORE_ERROR;
+        free(arr);
+    }
+    else
+    {
+        Txn *t = txn_begin();
+        if (!t) fail("txn_begin failed");
+        int nsub = s->kind == S_TXN ? s->nsub : 1;
+        for (int k = 0; k < nsub; ++k)
+        {
+            int kind = s->kind == S_TXN ? s->sub_kind[k] : s->kind;
+            const Student *rec = s->kind == S_TXN ? &s->sub[k] : &s->rec;
+            int roll = s->kind == S_DELETE ? s->roll : rec->roll;
+            if (kind == S_INSERT) res[k] = txn_insert(t, rec);
+            else if (kind == S_UPDATE) res[k] = txn_update(t, rec);
+            else res[k] = txn_delete(t, roll);
+        }
+        res[nsub] = txn_commit(t);
+        if (s->kind != S_TXN) res[0] = res[0] == STORE_OK ? res[1] : res[0];
+    }
+}
+
+static int store_sorted(const char *key, Student arr[], int (*cmp)(const void *, const void *))
+{
+    long got = cache_get(key, store_generation(), arr, sizeof(Student) * MAX_STUDENTS);
+    if (got >= 0) return (int)(got / sizeof(Student));
+    int n = load_students(arr);
+    qsort(arr, n, sizeof(Student), cmp);
+    cache_put(key, loaded_generation, arr, sizeof(Student) * n);
+    return n;
+}
+
+static int store_query(const Query *q, Student arr[])
+{
+    char key[CACHE_KEY_LEN];
+    int keyed = query_key(q, key, sizeof(key));
+    long got;
+    if (keyed && (got = cache_get(key, store_generation(), arr, sizeof(Student) * MAX_STUDENTS)) >= 0)
+        return (int)(got / sizeof(Student));
+    int m = run_query(arr, load_students(arr), q);
+    if (keyed) cache_put(key, loaded_generation, arr, sizeof(Student) * m);
+    return m;
+}
+
+static void store_stats(StatsReport *r)
+{
+    static Student arr[MAX_STUDENTS];
+    if (cache_get(CACHE_STATISTICS, store_generation(), r, sizeof(*r)) >= 0) return;
+    int n = load_students(arr);
+    cache_put(CACHE_STATISTICS, loaded_generation, r, stats_report(arr, n, r));
+}
+
+/* ---------------- Random steps ---------------- */
+
+static Query queries[QUERY_POOL];
+
+// Whole hundredths, as the front ends store them, with grade boundaries
+// and the ends of the scale over-represented.
+static float random_marks(void)
+{
+    unsigned int r = rnd() % 10;
+    if (r == 0) return (grade_bounds[rnd() % GRADE_F] * 100 - (int)(rnd() % 2)) / 100.0f;
+    if (r == 1) return rnd() % 2 ? 0.0f : 100.0f;
+    return (int)(rnd() % 10001) / 100.0f;
+}
+
+static void random_student(Student *s, int roll)
+{
+    static const char *first[] = { "Anya", "Ravi", "Sita", "Karan", "Meera", "John", "Li", "Noor" };
+    static const char *last[] = { "Shah", "Rao", "Iyer", "Das", "Khan", "Smith", "Chen", "Paul" };
+    memset(s, 0, sizeof(*s));
+    s->roll = roll;
+    snprintf(s->name, sizeof(s->name), "%s %s", first[rnd() % 8], last[rnd() % 8]);
+    snprintf(s->section, sizeof(s->section), "%c", 'A' + rnd() % 6);
+    s->marks = random_marks();
+    calc_grade_from_marks(s);
+    if (strcmp(s->grade, ref_grade(s->marks)) != 0)
+        fail("calc_grade_from_marks(%.2f) gives %s, model %s", s->marks, s->grade, ref_grade(s->marks));
+}
+
+// A roll on file most of the time, so updates and deletes mostly hit.
+static int some_roll(void)
+{
+    if (model_n > 0 && rnd() % 10 != 0) return model[rnd() % model_n].roll;
+    return 1 + rnd() % max_roll;
+}
+
+static void random_query(Query *q)
+{
+    static const char *ops[] = { "==", "!=", "<", "<=", ">", ">=" };
+    static const char *fields[] = { "roll", "name", "section", "marks", "grade" };
+    char text[256] = "", err[128];
+    int len = 0, np = rnd() % 4;
+    for (int k = 0; k < np; ++k)
+    {
+        int f = rnd() % 5;
+        len += snprintf(text + len, sizeof(text) - len, "%s%s %s ", k ? "&& " : "", fields[f], ops[rnd() % 6]);
+        const Student *s = model_n > 0 ? &model[rnd() % model_n] : NULL;
+        if (f == F_ROLL) len += snprintf(text + len, sizeof(text) - len, "%d ", s ? s->roll : 1);
+        else if (f == F_MARKS) len += snprintf(text + len, sizeof(text) - len, "%.2f ", random_marks());
+        else if (f == F_NAME) len += snprintf(text + len, sizeof(text) - len, "\"%s\" ", s ? s->name : "x");
+        else if (f == F_SECTION) len += snprintf(text + len, sizeof(text) - len, "\"%c\" ", 'A' + rnd() % 6);
+        else len += snprintf(text + len, sizeof(text) - len, "\"%s\" ", grade_names[rnd() % GRADE_COUNT]);
+    }
+    if (rnd() % 2)
+        len += snprintf(text + len, sizeof(text) - len, "order by %s %s ", fields[rnd() % 5], rnd() % 2 ? "desc" : "asc");
+    if (rnd() % 3 == 0) snprintf(text + len, sizeof(text) - len, "limit %d", 1 + rnd() % 50);
+    if (!compile_query(text, q, err, sizeof(err))) fail("generated query '%s' rejected: %s", text, err);
+}
+
+static int pick_kind(void)
+{
+    int total = 0;
+    for (int k = 0; k < S_KINDS; ++k) total += step_weights[k];
+    int r = rnd() % total, k = 0;
+    while (r >= step_weights[k]) r -= step_weights[k++];
+    // Drift toward the target size and never past what load_students reads.
+    if (k == S_INSERT && model_n >= target && rnd() % 2) k = S_DELETE;
+    if (k == S_DELETE && model_n < target && rnd() % 2) k = S_INSERT;
+    if ((k == S_INSERT || k == S_APPEND || k == S_TXN) && model_n >= ROSTER_LIMIT) k = S_DELETE;
+    if (k == S_APPEND && model_n == 0) k = S_INSERT;
+    return k;
+}
+
+static void random_step(Step *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->kind = pick_kind();
+    switch (s->kind)
+    {
+    case S_INSERT:
+        random_student(&s->rec, 1 + rnd() % max_roll);
+        break;
+    case S_APPEND: // a second record for a roll on file; only append_student allows it
+        random_student(&s->rec, model[rnd() % model_n].roll);
+        break;
+    case S_UPDATE:
+        random_student(&s->rec, some_roll());
+        break;
+    case S_DELETE:
+        s->roll = some_roll();
+        s->via_save = rnd() % 2;
+        break;
+    case S_LOOKUP:
+    case S_RANK:
+        s->roll = some_roll();
+        break;
+    case S_TXN:
+        s->nsub = 2 + rnd() % (MAX_SUB - 1);
+        for (int k = 0; k < s->nsub; ++k)
+        {
+            s->sub_kind[k] = (int[]){ S_INSERT, S_UPDATE, S_DELETE }[rnd() % 3];
+            random_student(&s->sub[k], s->sub_kind[k] == S_INSERT ? (int)(1 + rnd() % max_roll) : some_roll());
+        }
+        if (rnd() % 8 == 0) s->sub[rnd() % s->nsub].marks = 150; // commit must refuse it
+        break;
+    case S_QUERY:
+        s->query = rnd() % QUERY_POOL;
+        if (rnd() % 4 == 0) random_query(&queries[s->query]);
+        break;
+    case S_PAGE:
+        s->page_start = model_n > 0 ? (int)(rnd() % model_n) : 0;
+        break;
+    }
+}
+
+/* ---------------- Running and checking ---------------- */
+
+static void check_stats(const StatsReport *r, const StatsReport *w)
+{
+    if (r->n != w->n) fail("statistics: n %d, model %d", r->n, w->n);
+    if (w->n == 0) return;
+    if (r->total != w->total || r->min != w->min || r->max != w->max)
+        fail("statistics: total/min/max %.2f/%.2f/%.2f, model %.2f/%.2f/%.2f", r->total, r->min, r->max, w->total, w->min, w->max);
+    if (r->median != w->median || r->p10 != w->p10 || r->p25 != w->p25 || r->p75 != w->p75 || r->p90 != w->p90)
+        fail("statistics: median/p10/p25/p75/p90 %.2f/%.2f/%.2f/%.2f/%.2f, model %.2f/%.2f/%.2f/%.2f/%.2f",
+             r->median, r->p10, r->p25, r->p75, r->p90, w->median, w->p10, w->p25, w->p75, w->p90);
+    if (fabs(r->stddev - w->stddev) > 1e-6 * (1 + w->stddev))
+        fail("statistics: stddev %.9f, model %.9f", r->stddev, w->stddev);
+    if (memcmp(r->grade_counts, w->grade_counts, sizeof(r->grade_counts)) != 0) fail("statistics: grade counts differ");
+    if (r->ngroups != w->ngroups) fail("statistics: %d sections, model %d", r->ngroups, w->ngroups);
+    for (int k = 0; k < w->ngroups; ++k)
+    {
+        const SectionStats *b = &w->groups[k], *a = r->groups;
+        while (a < r->groups + r->ngroups && strcmp(a->section, b->section) != 0) a++;
+        if (a == r->groups + r->ngroups) fail("statistics: section %s missing", b->section);
+        if (a->count != b->count || a->total != b->total || a->min != b->min || a->max != b->max ||
+            memcmp(a->grade_counts, b->grade_counts, sizeof(a->grade_counts)) != 0)
+            fail("statistics: section %s has %d records, total %.2f; model %d, %.2f", b->section, a->count, a->total, b->count, b->total);
+    }
+}
+
+// The snapshot must still hold the roster it was taken from, however many
+// writes have landed since.
+static void check_snapshot(void)
+{
+    int n;
+    if (snap_n < 0) return;
+    Student *arr = snapshot_load(SNAPSHOT_NAME, &n);
+    expect_rows("snapshot", arr, n, snap_model, snap_n);
+    free(arr);
+}
+
+static void run_write(const Step *s)
+{
+    int got[MAX_SUB + 1], want[MAX_SUB + 1];
+    int nres = s->kind == S_TXN ? s->nsub + 1 : 1;
+    unsigned long long gen = store_generation();
+
+    double t0 = now_ns();
+    store_write(s, got);
+    double t1 = now_ns();
+    model_load();
+    int changed = ref_write(s, model, &model_n, want);
+    if (changed) model_save();
+    double t2 = now_ns();
+
+    timing[s->kind].store_ns += t1 - t0;
+    timing[s->kind].model_ns += t2 - t1;
+    for (int k = 0; k < nres; ++k)
+        if (got[k] != want[k]) fail("result %d is %d, model %d", k, got[k], want[k]);
+    if (changed != (store_generation() != gen)) fail("generation %s", changed ? "did not move" : "moved without a change");
+}
+
+static void run_read(const Step *s)
+{
+    static Student got[MAX_STUDENTS], want[MAX_STUDENTS];
+    static StatsReport r, w;
+    int ngot = 0, nwant = 0;
+    const Student *hit = NULL;
+    Student found;
+    double t0 = now_ns(), t1, t2;
+
+    switch (s->kind)
+    {
+    case S_LOOKUP:
+    {
+        Txn *t = txn_begin();
+        hit = t ? txn_find(t, s->roll) : NULL;
+        if (hit) found = *hit;
+        txn_abort(t);
+        t1 = now_ns();
+        model_load();
+        int i = ref_find(model, model_n, s->roll);
+        t2 = now_ns();
+        if ((hit != NULL) != (i >= 0)) fail("lookup %s, model %s", hit ? "found" : "missed", i >= 0 ? "found" : "missed");
+        if (hit) expect_rows("lookup", &found, 1, &model[i], 1);
+        break;
+    }
+    case S_QUERY:
+        ngot = store_query(&queries[s->query], got);
+        t1 = now_ns();
+        model_load();
+        nwant = ref_query(&queries[s->query], want);
+        t2 = now_ns();
+        expect_rows("query", got, ngot, want, nwant);
+        break;
+    case S_SORT_MARKS:
+    case S_SORT_ROLL:
+        ngot = s->kind == S_SORT_MARKS ? store_sorted(CACHE_SORT_MARKS, got, cmp_marks_desc)
+                                       : store_sorted(CACHE_SORT_ROLL, got, cmp_roll_asc);
+        t1 = now_ns();
+        model_load();
+        memcpy(want, model, sizeof(Student) * model_n);
+        nwant = model_n;
+        qsort(want, nwant, sizeof(Student), s->kind == S_SORT_MARKS ? ref_cmp_marks : ref_cmp_roll);
+        t2 = now_ns();
+        expect_rows(step_names[s->kind], got, ngot, want, nwant);
+        break;
+    case S_STATS:
+        store_stats(&r);
+        t1 = now_ns();
+        model_load();
+        ref_stats(&w);
+        t2 = now_ns();
+        check_stats(&r, &w);
+        break;
+    case S_PAGE:
+    {
+        PagedReader *pr = pager_open(0);
+        if (!pr) fail("pager_open failed");
+        ngot = pager_count(pr);
+        for (int i = s->page_start; i < ngot && i < s->page_start + PAGE_RECORDS * 2; ++i)
+        {
+            const Student *p = pager_get(pr, i);
+            if (!p) fail("pager_get(%d) failed", i);
+            got[nwant++] = *p;
+        }
+        pager_close(pr);
+        t1 = now_ns();
+        model_load();
+        t2 = now_ns();
+        if (ngot != model_n) fail("pager_count %d, model %d", ngot, model_n);
+        expect_rows("page", got, nwant, &model[s->page_start], nwant);
+        break;
+    }
+    case S_RANK:
+    {
+        RankInfo ri;
+        int found = rank_of_roll(s->roll, &ri);
+        t1 = now_ns();
+        model_load();
+        int i = ref_find(model, model_n, s->roll), above = 0, below = 0;
+        for (int k = 0; i >= 0 && k < model_n; ++k)
+        {
+            int d = hist_bucket(model[k].marks) - hist_bucket(model[i].marks);
+            above += d > 0;
+            below += d < 0;
+        }
+        t2 = now_ns();
+        if (found < 0) fail("rank_of_roll failed");
+        if (found != (i >= 0)) fail("rank %s, model %s", found ? "found" : "missed", i >= 0 ? "found" : "missed");
+        if (found)
+        {
+            expect_rows("rank", &ri.rec, 1, &model[i], 1);
+            if (ri.rank != above + 1 || ri.below != below || ri.n != model_n)
+                fail("rank %d of %d (%d below), model %d of %d (%d below)", ri.rank, ri.n, ri.below, above + 1, model_n, below);
+        }
+        break;
+    }
+    case S_SNAPSHOT:
+        check_snapshot();
+        if (snap_n >= 0 && snapshot_drop(SNAPSHOT_NAME) != STORE_OK) fail("snapshot_drop failed");
+        if (snapshot_create(SNAPSHOT_NAME, NULL) != STORE_OK) fail("snapshot_create failed");
+        t1 = now_ns();
+        model_load();
+        memcpy(snap_model, model, sizeof(Student) * model_n);
+        snap_n = model_n;
+        t2 = now_ns();
+        break;
+    default:
+        ngot = count_students();
+        t1 = now_ns();
+        model_load();
+        t2 = now_ns();
+        if (ngot != model_n) fail("count_students %d, model %d", ngot, model_n);
+        break;
+    }
+    timing[s->kind].store_ns += t1 - t0;
+    timing[s->kind].model_ns += t2 - t1;
+}
+
+static void verify_file(void)
+{
+    int n;
+    Student *arr = load_all_students(&n);
+    expect_rows("file", arr, n, model, model_n);
+    free(arr);
+}
+
+// The newest change events must read back in sequence, with generations
+// that never run ahead of the store's.
+static void check_change_stream(void)
+{
+    ChangeRecord recs[64];
+    unsigned long long last = cdc_last_seq(), from = last > 64 ? last - 63 : 1;
+    int got = cdc_read(from, recs, 64);
+    if (last > 0 && (unsigned long long)got != last - from + 1)
+        fail("change stream: %d readable from %llu, expected %llu", got, from, last - from + 1);
+    unsigned long long gen = store_generation();
+    for (int k = 0; k < got; ++k)
+        if (recs[k].generation > gen || (k && recs[k].generation < recs[k-1].generation))
+            fail("change stream: seq %llu has generation %llu (store at %llu)", recs[k].seq, recs[k].generation, gen);
+}
+
+static const char *crash_points[] = {
+    "save:written", "save:renamed", "save:bumped", "save:logged",
+    "append:torn", "append:written", "append:bumped", "cdc:torn"
+};
+#define NCRASH_POINTS (int)(sizeof(crash_points) / sizeof(crash_points[0]))
+
+static long crashes, crashes_old, crashes_new; // writers killed; of those that had a change, kept old / new
+
+// Runs s in a child that dies at a random crash point, then checks what it
+// left behind and adopts it into the model.
+static void run_crashed(const Step *s)
+{
+    static Student before[MAX_STUDENTS];
+    int want[MAX_SUB + 1], nbefore = model_n;
+    memcpy(before, model, sizeof(Student) * model_n);
+    int changed = ref_write(s, model, &model_n, want);
+    unsigned long long gen = store_generation(), seq = cdc_last_seq();
+    const char *point = crash_points[rnd() % NCRASH_POINTS];
+
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) fail("fork: %s", strerror(errno));
+    if (pid == 0)
+    {
+        int res[MAX_SUB + 1];
+        crash_point_armed = point;
+        store_write(s, res);
+        _exit(0);
+    }
+    int status;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+        (WEXITSTATUS(status) != 0 && WEXITSTATUS(status) != CRASH_EXIT_STATUS))
+        fail("writer did not exit cleanly (status %d)", status);
+    int killed = WEXITSTATUS(status) == CRASH_EXIT_STATUS;
+    crashes += killed;
+
+    int n;
+    Student *arr = load_all_students(&n);
+    int is_new = n == model_n, is_old = n == nbefore;
+    for (int i = 0; is_new && i < n; ++i) is_new = same_student(&arr[i], &model[i]);
+    for (int i = 0; is_old && i < n; ++i) is_old = same_student(&arr[i], &before[i]);
+    free(arr);
+    if (!is_new && !is_old) fail("crash at %s left neither the old nor the new roster (%d records)", point, n);
+    if (!is_new)
+    {
+        model_n = nbefore;
+        memcpy(model, before, sizeof(Student) * nbefore);
+    }
+    if (killed && changed) ++*(is_new ? &crashes_new : &crashes_old);
+    if (changed && is_new && store_generation() == gen)
+        fail("crash at %s changed the roster without moving the generation", point);
+    // The stream is written ahead: it gains events exactly when the change landed.
+    unsigned long long seq_after = cdc_last_seq();
+    if (changed && is_new && seq_after == seq)
+        fail("crash at %s changed the roster but logged no change", point);
+    if (!(changed && is_new) && seq_after != seq)
+        fail("crash at %s logged %llu change(s) the roster does not have", point, seq_after - seq);
+    model_save();
+    check_change_stream();
+}
+
+static void boundary_sweep(void)
+{
+    Student s = {0};
+    for (int k = 0; k <= 10000; ++k)
+    {
+        float m[3] = { k / 100.0f, nextafterf(k / 100.0f, -1), nextafterf(k / 100.0f, 101) };
+        for (int j = 0; j < 3; ++j)
+        {
+            s.marks = m[j] < 0 ? 0 : m[j] > 100 ? 100 : m[j];
+            calc_grade_from_marks(&s);
+            if (strcmp(s.grade, ref_grade(s.marks)) != 0)
+                fail("calc_grade_from_marks(%.9g) gives %s, model %s", s.marks, s.grade, ref_grade(s.marks));
+        }
+    }
+}
+
+static void print_report(long ops, double elapsed)
+{
+    double store_total = 0, model_total = 0;
+    long timed = 0;
+    printf("\n%-12s %9s %14s %14s %9s\n", "operation", "count", "store ops/s", "model ops/s", "speedup");
+    for (int k = 0; k < S_KINDS; ++k)
+    {
+        const StepTiming *t = &timing[k];
+        if (t->count == 0) continue;
+        timed += t->count;
+        store_total += t->store_ns;
+        model_total += t->model_ns;
+        printf("%-12s %9ld %14.0f %14.0f %8.2fx\n", step_names[k], t->count,
+               t->store_ns > 0 ? t->count / (t->store_ns / 1e9) : 0,
+               t->model_ns > 0 ? t->count / (t->model_ns / 1e9) : 0,
+               t->store_ns > 0 ? t->model_ns / t->store_ns : 0);
+    }
+    printf("%-12s %9ld %14.0f %14.0f %8.2fx\n", "all", timed,
+           store_total > 0 ? timed / (store_total / 1e9) : 0,
+           model_total > 0 ? timed / (model_total / 1e9) : 0,
+           store_total > 0 ? model_total / store_total : 0);
+    printf("\n%ld steps in %.1f s, no mismatches\n", ops, elapsed / 1e9);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-n steps] [--seed N] [--records N] [--crash N] [--verify N] [--dir path]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    long ops = 100000;
+    int crash_every = 0, verify_every = 1;
+    const char *dir = "stress_data";
+    target = 1000;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) ops = atol(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--records") == 0 && i + 1 < argc) target = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--crash") == 0 && i + 1 < argc) crash_every = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--verify") == 0 && i + 1 < argc) verify_every = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) dir = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (ops <= 0 || target <= 0 || target > ROSTER_LIMIT || crash_every < 0 || verify_every < 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    rng_state = seed * 0x9E3779B97F4A7C15ULL | 1;
+    max_roll = target * 3;
+
+    mkdir(dir, 0755);
+    if (chdir(dir) != 0)
+    {
+        fprintf(stderr, "Cannot use directory %s: %s\n", dir, strerror(errno));
+        return 1;
+    }
+    remove(FILE_NAME);
+    remove(LOCK_FILE_NAME);
+    remove(CDC_FILE_NAME);
+    remove(MODEL_FILE_NAME);
+    remove(GRADE_CONFIG_FILE);
+    snapshot_drop(SNAPSHOT_NAME);
+    load_grade_policy();
+    boundary_sweep();
+    for (int k = 0; k < QUERY_POOL; ++k) random_query(&queries[k]);
+    free(load_all_students(&(int){0})); // sync loaded_generation with the fresh lock file
+    printf("Stress run: %ld steps, about %d records, seed %llu%s\n", ops, target, seed,
+           crash_every ? ", with crash injection" : "");
+
+    double start = now_ns();
+    long next_crash = crash_every;
+    for (step_no = 1; step_no <= ops; ++step_no)
+    {
+        random_step(&cur);
+        if (cur.kind <= S_TXN && crash_every && step_no >= next_crash)
+        {
+            run_crashed(&cur);
+            next_crash = step_no + crash_every;
+        }
+        else
+        {
+            timing[cur.kind].count++;
+            if (cur.kind <= S_TXN) run_write(&cur);
+            else run_read(&cur);
+        }
+        if (verify_every && step_no % verify_every == 0) verify_file();
+        if (step_no % 100000 == 0)
+        {
+            printf("  %ld steps, %d records\n", step_no, model_n);
+            fflush(stdout);
+        }
+    }
+    double elapsed = now_ns() - start;
+    verify_file();
+    check_change_stream();
+    check_snapshot();
+    print_report(ops, elapsed);
+    if (crash_every)
+        printf("%ld writers killed at a crash point: %ld changes lost whole, %ld kept whole; all recovered\n",
+               crashes, crashes_old, crashes_new);
+    return 0;
+}
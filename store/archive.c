@@ -0,0 +1,369 @@
+// archive.c
+// Compressed, seekable archive format for archived terms (.sma files).
+//
+// Layout: a header, then blocks of up to ARCHIVE_BLOCK_RECORDS records,
+// then a block index. Inside a block the records are stored column by
+// column -- rolls as delta varints, marks as raw floats, then each string
+// column as lengths followed by the bytes, without the padding and stale
+// bytes of the fixed-width Student -- and the block is deflated as a whole.
+// Each index entry carries the block's roll range, marks range and section
+// mask, so a query inflates only the blocks that can hold a match.
+//
+// Built without zlib (-DSMS_NO_ZLIB) blocks are written uncompressed; the
+// columnar encoding alone still roughly halves the size.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#ifndef SMS_NO_ZLIB
+#include <zlib.h>
+#endif
+
+#include "student_store.h"
+
+#define ARCHIVE_MAGIC "SMSA"
+#define ARCHIVE_VERSION 1
+#define MAX_ENCODED_RECORD (5 + 4 + 1 + 50 + 1 + 10 + 1 + 6)
+
+enum { CODEC_STORED, CODEC_DEFLATE };
+
+typedef struct
+{
+    char magic[4];
+    int version;
+    int nblocks;
+    int nrecords;
+    unsigned long long index_offset;
+} ArchiveHeader;
+
+typedef struct
+{
+    unsigned long long offset;
+    unsigned int clen, rawlen;
+    int nrecs;
+    int codec;
+    int roll_min, roll_max;
+    float marks_min, marks_max;
+    unsigned long long section_mask;
+} BlockIndex;
+
+struct ArchiveReader
+{
+    FILE *fp;
+    ArchiveHeader hdr;
+    BlockIndex *index;
+    unsigned char *cbuf, *rbuf;
+    Student *recs; // decoded block
+    int blocks_read;
+};
+
+/* ---------------- Column encoding ---------------- */
+
+static unsigned char *put_varint(unsigned char *p, unsigned int v)
+{
+    while (v >= 0x80)
+    {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+static const unsigned char *get_varint(const unsigned char *p, const unsigned char *end, unsigned int *v)
+{
+    unsigned int x = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7)
+    {
+        unsigned char b = *p++;
+        x |= (unsigned int)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+        {
+            *v = x;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// Writes one string column (the field at offset, of the given size): all
+// lengths, then all bytes.
+static unsigned char *put_strings(unsigned char *p, const Student arr[], int n, size_t offset, size_t size)
+{
+    unsigned char *bytes = p + n;
+    for (int i = 0; i < n; ++i)
+    {
+        const char *field = (const char *)&arr[i] + offset;
+        size_t len = strnlen(field, size - 1);
+        p[i] = (unsigned char)len;
+        memcpy(bytes, field, len);
+        bytes += len;
+    }
+    return bytes;
+}
+
+static size_t encode_block(const Student arr[], int n, unsigned char *out)
+{
+    unsigned char *p = out;
+    int prev = 0;
+    for (int i = 0; i < n; ++i) // zigzag deltas: sorted or clustered rolls take one byte
+    {
+        int d = (int)((unsigned int)arr[i].roll - (unsigned int)prev); // wraps, never overflows
+        p = put_varint(p, ((unsigned int)d << 1) ^ (unsigned int)(d >> 31));
+        prev = arr[i].roll;
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        memcpy(p, &arr[i].marks, sizeof(float));
+        p += sizeof(float);
+    }
+    p = put_strings(p, arr, n, offsetof(Student, name), sizeof(arr[0].name));
+    p = put_strings(p, arr, n, offsetof(Student, section), sizeof(arr[0].section));
+    p = put_strings(p, arr, n, offsetof(Student, grade), sizeof(arr[0].grade));
+    return (size_t)(p - out);
+}
+
+static const unsigned char *get_strings(const unsigned char *p, const unsigned char *end, Student recs[], int n,
+                                        size_t offset, size_t size)
+{
+    const unsigned char *lens = p, *bytes = p + n;
+    if (bytes > end) return NULL;
+    for (int i = 0; i < n; ++i)
+    {
+        size_t len = lens[i];
+        if (len >= size || bytes + len > end) return NULL;
+        char *field = (char *)&recs[i] + offset;
+        memcpy(field, bytes, len);
+        field[len] = '\0';
+        bytes += len;
+    }
+    return bytes;
+}
+
+static int decode_block(const unsigned char *p, size_t len, Student recs[], int n)
+{
+    const unsigned char *end = p + len;
+    memset(recs, 0, sizeof(Student) * n);
+    int prev = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        unsigned int z;
+        if (!(p = get_varint(p, end, &z))) return 0;
+        prev = (int)((unsigned int)prev + ((z >> 1) ^ (0u - (z & 1))));
+        recs[i].roll = prev;
+    }
+    if (p + sizeof(float) * n > end) return 0;
+    for (int i = 0; i < n; ++i)
+    {
+        memcpy(&recs[i].marks, p, sizeof(float));
+        p += sizeof(float);
+    }
+    if (!(p = get_strings(p, end, recs, n, offsetof(Student, name), sizeof(recs[0].name)))) return 0;
+    if (!(p = get_strings(p, end, recs, n, offsetof(Student, section), sizeof(recs[0].section)))) return 0;
+    if (!(p = get_strings(p, end, recs, n, offsetof(Student, grade), sizeof(recs[0].grade)))) return 0;
+    return p == end;
+}
+
+/* ---------------- Writing ---------------- */
+
+// Writes arr[0..n) to path as an archive, atomically. level is the zlib
+// level (1 fastest to 9 smallest); 0 stores blocks uncompressed. Records
+// are stored in roll order, so blocks cover disjoint roll ranges and a
+// roll lookup inflates a single block.
+int archive_write(const char *path, const Student arr_in[], int n, int level)
+{
+    Student *arr = malloc(sizeof(Student) * (n > 0 ? n : 1));
+    if (!arr) return STORE_ERROR;
+    memcpy(arr, arr_in, sizeof(Student) * n);
+    qsort(arr, n, sizeof(Student), cmp_roll_asc);
+
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    int nblocks = (n + ARCHIVE_BLOCK_RECORDS - 1) / ARCHIVE_BLOCK_RECORDS;
+    size_t rawcap = (size_t)ARCHIVE_BLOCK_RECORDS * MAX_ENCODED_RECORD;
+    size_t ccap = rawcap + rawcap / 1000 + 64;
+    unsigned char *raw = malloc(rawcap), *comp = malloc(ccap);
+    BlockIndex *index = calloc(nblocks > 0 ? nblocks : 1, sizeof(BlockIndex));
+    FILE *fp = raw && comp && index ? fopen(tmp, "wb") : NULL;
+    int ok = fp != NULL;
+
+    ArchiveHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, ARCHIVE_MAGIC, 4);
+    hdr.version = ARCHIVE_VERSION;
+    hdr.nblocks = nblocks;
+    hdr.nrecords = n;
+    ok = ok && fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    unsigned long long offset = sizeof(hdr);
+
+    for (int b = 0; ok && b < nblocks; ++b)
+    {
+        const Student *blk = arr + (size_t)b * ARCHIVE_BLOCK_RECORDS;
+        int m = n - b * ARCHIVE_BLOCK_RECORDS;
+        if (m > ARCHIVE_BLOCK_RECORDS) m = ARCHIVE_BLOCK_RECORDS;
+        BlockIndex *bi = &index[b];
+        bi->nrecs = m;
+        bi->roll_min = bi->roll_max = blk[0].roll;
+        bi->marks_min = bi->marks_max = blk[0].marks;
+        for (int i = 0; i < m; ++i)
+        {
+            if (blk[i].roll < bi->roll_min) bi->roll_min = blk[i].roll;
+            if (blk[i].roll > bi->roll_max) bi->roll_max = blk[i].roll;
+            if (blk[i].marks < bi->marks_min) bi->marks_min = blk[i].marks;
+            if (blk[i].marks > bi->marks_max) bi->marks_max = blk[i].marks;
+            bi->section_mask |= section_bit(blk[i].section);
+        }
+        bi->rawlen = (unsigned int)encode_block(blk, m, raw);
+        const unsigned char *payload = raw;
+        bi->clen = bi->rawlen;
+        bi->codec = CODEC_STORED;
+#ifndef SMS_NO_ZLIB
+        uLongf clen = (uLongf)ccap;
+        if (level > 0 && compress2(comp, &clen, raw, bi->rawlen, level) == Z_OK && clen < bi->rawlen)
+        {
+            payload = comp;
+            bi->clen = (unsigned int)clen;
+            bi->codec = CODEC_DEFLATE;
+        }
+#else
+        (void)level;
+#endif
+        bi->offset = offset;
+        ok = fwrite(payload, 1, bi->clen, fp) == bi->clen;
+        offset += bi->clen;
+    }
+    hdr.index_offset = offset;
+    ok = ok && fwrite(index, sizeof(BlockIndex), nblocks, fp) == (size_t)nblocks;
+    ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    ok = ok && fflush(fp) == 0;
+#ifndef _WIN32
+    ok = ok && fsync(fileno(fp)) == 0;
+#endif
+    if (fp) ok = fclose(fp) == 0 && ok;
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tmp, path) == 0;
+#endif
+    if (!ok && fp) remove(tmp);
+    free(raw);
+    free(comp);
+    free(index);
+    free(arr);
+    return ok ? STORE_OK : STORE_ERROR;
+}
+
+/* ---------------- Reading ---------------- */
+
+ArchiveReader *archive_open(const char *path)
+{
+    ArchiveReader *a = calloc(1, sizeof(ArchiveReader));
+    if (!a) return NULL;
+    a->fp = fopen(path, "rb");
+    int ok = a->fp && fread(&a->hdr, sizeof(a->hdr), 1, a->fp) == 1 &&
+             memcmp(a->hdr.magic, ARCHIVE_MAGIC, 4) == 0 && a->hdr.version == ARCHIVE_VERSION &&
+             a->hdr.nblocks >= 0;
+    if (ok)
+    {
+        size_t rawcap = (size_t)ARCHIVE_BLOCK_RECORDS * MAX_ENCODED_RECORD;
+        a->index = malloc(sizeof(BlockIndex) * (a->hdr.nblocks > 0 ? a->hdr.nblocks : 1));
+        a->cbuf = malloc(rawcap + rawcap / 1000 + 64);
+        a->rbuf = malloc(rawcap);
+        a->recs = malloc(sizeof(Student) * ARCHIVE_BLOCK_RECORDS);
+        ok = a->index && a->cbuf && a->rbuf && a->recs &&
+             fseek(a->fp, (long)a->hdr.index_offset, SEEK_SET) == 0 &&
+             fread(a->index, sizeof(BlockIndex), a->hdr.nblocks, a->fp) == (size_t)a->hdr.nblocks;
+        for (int b = 0; ok && b < a->hdr.nblocks; ++b)
+            ok = a->index[b].nrecs > 0 && a->index[b].nrecs <= ARCHIVE_BLOCK_RECORDS &&
+                 a->index[b].rawlen <= rawcap && a->index[b].clen <= rawcap + rawcap / 1000 + 64;
+    }
+    if (!ok)
+    {
+        archive_close(a);
+        return NULL;
+    }
+    return a;
+}
+
+int archive_count(const ArchiveReader *a)
+{
+    return a->hdr.nrecords;
+}
+
+int archive_blocks_read(const ArchiveReader *a)
+{
+    return a->blocks_read;
+}
+
+// Inflates and decodes block b into a->recs. Returns its record count, or
+// -1 if the block is damaged.
+static int load_block(ArchiveReader *a, int b)
+{
+    const BlockIndex *bi = &a->index[b];
+    unsigned char *raw = bi->codec == CODEC_STORED ? a->rbuf : a->cbuf;
+    if (fseek(a->fp, (long)bi->offset, SEEK_SET) != 0 || fread(raw, 1, bi->clen, a->fp) != bi->clen) return -1;
+    if (bi->codec == CODEC_DEFLATE)
+    {
+#ifndef SMS_NO_ZLIB
+        uLongf len = bi->rawlen;
+        if (uncompress(a->rbuf, &len, a->cbuf, bi->clen) != Z_OK || len != bi->rawlen) return -1;
+#else
+        return -1;
+#endif
+    }
+    else if (bi->codec != CODEC_STORED)
+        return -1;
+    a->blocks_read++;
+    return decode_block(a->rbuf, bi->rawlen, a->recs, bi->nrecs) ? bi->nrecs : -1;
+}
+
+// Appends every record matching q to *out (malloc'd, grown as needed;
+// *cap tracks its capacity) and returns the new count, or -1 on a damaged
+// archive. Blocks whose index entry rules q out are never read.
+int archive_query(ArchiveReader *a, const Query *q, Student **out, int *n, int *cap)
+{
+    for (int b = 0; b < a->hdr.nblocks; ++b)
+    {
+        const BlockIndex *bi = &a->index[b];
+        Partition meta;
+        meta.roll_min = bi->roll_min;
+        meta.roll_max = bi->roll_max;
+        meta.marks_min = bi->marks_min;
+        meta.marks_max = bi->marks_max;
+        meta.section_mask = bi->section_mask;
+        if (!partition_may_match(&meta, q)) continue;
+        int m = load_block(a, b);
+        if (m < 0) return -1;
+        for (int i = 0; i < m; ++i)
+        {
+            if (!query_match(&a->recs[i], q)) continue;
+            if (*n == *cap)
+            {
+                int ncap = *cap ? *cap * 2 : 64;
+                Student *grown = realloc(*out, sizeof(Student) * ncap);
+                if (!grown) return -1;
+                *out = grown;
+                *cap = ncap;
+            }
+            (*out)[(*n)++] = a->recs[i];
+        }
+    }
+    return *n;
+}
+
+void archive_close(ArchiveReader *a)
+{
+    if (!a) return;
+    if (a->fp) fclose(a->fp);
+    free(a->index);
+    free(a->cbuf);
+    free(a->rbuf);
+    free(a->recs);
+    free(a);
+}
@@ -0,0 +1,80 @@
+// arena.c
+// Bump allocator for short-lived batches of records and UI state.
+//
+// An arena is one malloc'd block that holds its own header; allocations
+// just advance a pointer, and everything is released at once with
+// arena_free. When a block fills up a larger one is chained on, so callers
+// only need a good first guess, not an exact size.
+
+#include <stdlib.h>
+
+#include "student_store.h"
+
+#define ARENA_ALIGN 16
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next;
+    char *base;
+    size_t size, used;
+} ArenaBlock;
+
+struct Arena
+{
+    ArenaBlock *cur;  // block being filled; its chain leads back to first
+    ArenaBlock first; // lives in the same allocation as the arena
+};
+
+Arena *arena_new(size_t size)
+{
+    size_t header = ALIGN_UP(sizeof(Arena));
+    Arena *a = malloc(header + size);
+    if (!a) return NULL;
+    a->first.next = NULL;
+    a->first.base = (char *)a + header;
+    a->first.size = size;
+    a->first.used = 0;
+    a->cur = &a->first;
+    return a;
+}
+
+void *arena_alloc(Arena *a, size_t size)
+{
+    size = ALIGN_UP(size);
+    ArenaBlock *b = a->cur;
+    if (b->size - b->used < size)
+    {
+        size_t want = b->size * 2 > size ? b->size * 2 : size;
+        size_t header = ALIGN_UP(sizeof(ArenaBlock));
+        ArenaBlock *nb = malloc(header + want);
+        if (!nb) return NULL;
+        nb->next = b;
+        nb->base = (char *)nb + header;
+        nb->size = want;
+        nb->used = 0;
+        a->cur = b = nb;
+    }
+    void *p = b->base + b->used;
+    b->used += size;
+    return p;
+}
+
+// Drops every allocation but keeps the first block for reuse.
+void arena_reset(Arena *a)
+{
+    while (a->cur != &a->first)
+    {
+        ArenaBlock *next = a->cur->next;
+        free(a->cur);
+        a->cur = next;
+    }
+    a->first.used = 0;
+}
+
+void arena_free(Arena *a)
+{
+    if (!a) return;
+    arena_reset(a);
+    free(a);
+}
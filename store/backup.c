@@ -0,0 +1,520 @@
+// backup.c
+// Incremental backups of snapshots into a backup directory.
+//
+// A backup cuts the snapshot into chunks at boundaries chosen by the
+// records themselves: a chunk ends after a record whose roll hashes to a
+// fixed residue mod BACKUP_CHUNK_AVG, or after 4 * BACKUP_CHUNK_AVG records.
+// An insert, update or delete therefore changes only the chunk it falls
+// in, where fixed-size pages would all shift after a delete. Each distinct
+// chunk is stored once: its records go to the append-only BACKUP_PACK and a
+// fixed-size entry (content hash, offset, count) to BACKUP_INDEX, whose
+// position is the chunk's id. The hash only finds candidates: a chunk is
+// reused only if its bytes match the stored chunk's, so two chunks that
+// collide are both kept. The backup itself is <name>.man, a header
+// and the chunk ids as varint deltas, about a byte per chunk where nothing
+// changed. So a run writes the chunks that changed since the previous
+// backup plus a manifest of a few KB, and any backup can be read back whole.
+//
+// Runs into one directory are serialized by the lock file BACKUP_LOCK. A
+// crash may leave unindexed bytes at the end of the pack or a partial
+// index entry; both are cut off by the next run, and a manifest is only
+// renamed into place once everything it names is on disk.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#include <windows.h>
+#define ftruncate _chsize
+#define fsync _commit
+#else
+#include <unistd.h>
+#endif
+
+#include "student_store.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define BACKUP_PACK "chunks.pack"
+#define BACKUP_INDEX "chunks.idx"
+#define BACKUP_CATALOG "catalog"
+#define BACKUP_LOCK "lock"
+#define MANIFEST_MAGIC "SMB1"
+
+typedef struct
+{
+    unsigned long long hash;   // chunk_hash of the chunk's records
+    unsigned long long offset; // in BACKUP_PACK
+    int count;                 // records
+    int unused;
+} ChunkEntry;
+
+typedef struct
+{
+    char magic[4];
+    int records, chunks;
+    int unused;
+    long long taken;
+    unsigned long long generation;
+} ManifestHeader;
+
+static void backup_path(const char *dir, const char *file, char *out, int size)
+{
+    snprintf(out, size, "%s/%s", dir, file);
+}
+
+// 64-bit hash of a chunk's bytes, a word at a time.
+static unsigned long long chunk_hash(const Student *recs, int n)
+{
+    const unsigned char *p = (const unsigned char *)recs;
+    size_t len = (size_t)n * sizeof(Student), i = 0;
+    unsigned long long h = 14695981039346656037ULL ^ len, w;
+    for (; i + 8 <= len; i += 8)
+    {
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+    }
+    for (; i < len; ++i) h = (h ^ p[i]) * 1099511628211ULL;
+    return h ^ (h >> 32);
+}
+
+static int chunk_ends_after(const Student *s, int len)
+{
+    unsigned long long h = (unsigned long long)(unsigned int)s->roll * 0x9E3779B97F4A7C15ULL;
+    return len >= 4 * BACKUP_CHUNK_AVG || (h >> 40) % BACKUP_CHUNK_AVG == 0;
+}
+
+// Whole entries of BACKUP_INDEX, in a malloc'd array.
+static ChunkEntry *read_index(const char *dir, int *n)
+{
+    char path[512];
+    struct stat st;
+    *n = 0;
+    backup_path(dir, BACKUP_INDEX, path, sizeof(path));
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+    ChunkEntry *idx = NULL;
+    if (fstat(fileno(fp), &st) == 0 && st.st_size >= (long long)sizeof(ChunkEntry))
+    {
+        size_t want = (size_t)st.st_size / sizeof(ChunkEntry);
+        idx = malloc(want * sizeof(ChunkEntry));
+        if (idx) *n = (int)fread(idx, sizeof(ChunkEntry), want, fp);
+    }
+    fclose(fp);
+    return idx;
+}
+
+/* ---------------- Chunk lookup ----------------
+ * Open-addressing table from content hash to chunk id, holding the chunks
+ * already stored and those this run adds.
+ */
+
+typedef struct
+{
+    unsigned long long *hashes;
+    int *ids; // -1 = empty
+    size_t slots;
+} ChunkTable;
+
+// Where the chunks a table names live, to compare their bytes.
+typedef struct
+{
+    const ChunkEntry *idx; // chunks already stored, read back from pack
+    int nidx;
+    FILE *pack;
+    const ChunkEntry *fresh; // chunks this run adds, still in recs
+    const int *starts;
+    const Student *recs;
+} ChunkSource;
+
+static int table_init(ChunkTable *t, size_t capacity)
+{
+    t->slots = 16;
+    while (t->slots < 2 * capacity) t->slots *= 2;
+    t->hashes = malloc(t->slots * sizeof(unsigned long long));
+    t->ids = malloc(t->slots * sizeof(int));
+    if (!t->hashes || !t->ids) return 0;
+    for (size_t i = 0; i < t->slots; ++i) t->ids[i] = -1;
+    return 1;
+}
+
+static void table_put(ChunkTable *t, size_t slot, unsigned long long hash, int id)
+{
+    t->hashes[slot] = hash;
+    t->ids[slot] = id;
+}
+
+static int same_chunk(const ChunkSource *src, int id, const Student *recs, int count)
+{
+    Student stored[4 * BACKUP_CHUNK_AVG];
+    if (id >= src->nidx)
+    {
+        const ChunkEntry *e = &src->fresh[id - src->nidx];
+        return e->count == count && memcmp(&src->recs[src->starts[id - src->nidx]], recs, sizeof(Student) * count) == 0;
+    }
+    const ChunkEntry *e = &src->idx[id];
+    return e->count == count && count <= 4 * BACKUP_CHUNK_AVG && src->pack &&
+           fseek(src->pack, (long)e->offset, SEEK_SET) == 0 &&
+           fread(stored, sizeof(Student), count, src->pack) == (size_t)count &&
+           memcmp(stored, recs, sizeof(Student) * count) == 0;
+}
+
+// The slot of a stored chunk with these records, or the empty slot where
+// one would go. Only chunks with an equal hash are read back and compared.
+static size_t table_find(const ChunkTable *t, const ChunkSource *src, unsigned long long hash,
+                         const Student *recs, int count)
+{
+    size_t i = (size_t)(hash >> 20) & (t->slots - 1);
+    while (t->ids[i] >= 0 && !(t->hashes[i] == hash && same_chunk(src, t->ids[i], recs, count)))
+        i = (i + 1) & (t->slots - 1);
+    return i;
+}
+
+// An empty slot for hash, past any chunks that share it.
+static size_t table_free_slot(const ChunkTable *t, unsigned long long hash)
+{
+    size_t i = (size_t)(hash >> 20) & (t->slots - 1);
+    while (t->ids[i] >= 0) i = (i + 1) & (t->slots - 1);
+    return i;
+}
+
+static void table_free(ChunkTable *t)
+{
+    free(t->hashes);
+    free(t->ids);
+}
+
+/* ---------------- Manifests ---------------- */
+
+static int put_varint(unsigned char *out, long long v)
+{
+    unsigned long long z = ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63); // zigzag
+    int len = 0;
+    do
+    {
+        out[len++] = (unsigned char)((z & 0x7f) | (z > 0x7f ? 0x80 : 0));
+        z >>= 7;
+    } while (z);
+    return len;
+}
+
+static long long get_varint(const unsigned char **p, const unsigned char *end)
+{
+    unsigned long long z = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7)
+    {
+        unsigned char b = *(*p)++;
+        z |= (unsigned long long)(b & 0x7f) << shift;
+        if (!(b & 0x80)) break;
+    }
+    return (long long)(z >> 1) ^ -(long long)(z & 1);
+}
+
+// Writes dir/<name>.man for the given chunk ids. Returns its size, or -1.
+static long write_manifest(const char *dir, const Snapshot *snap, const int ids[], int nchunks)
+{
+    char path[512], tmp[520];
+    unsigned char *buf = malloc((size_t)nchunks * 10 + 1);
+    if (!buf) return -1;
+    ManifestHeader h = {0};
+    memcpy(h.magic, MANIFEST_MAGIC, 4);
+    h.records = snap->records;
+    h.chunks = nchunks;
+    h.taken = snap->taken;
+    h.generation = snap->generation;
+    size_t len = 0;
+    long long prev = -1;
+    for (int i = 0; i < nchunks; ++i)
+    {
+        len += put_varint(buf + len, ids[i] - prev);
+        prev = ids[i];
+    }
+    snprintf(path, sizeof(path), "%s/%s.man", dir, snap->name);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "wb");
+    int ok = fp != NULL;
+    if (fp)
+    {
+        ok = fwrite(&h, sizeof(h), 1, fp) == 1 && fwrite(buf, 1, len, fp) == len;
+        ok = fflush(fp) == 0 && ok;
+        ok = fsync(fileno(fp)) == 0 && ok;
+        ok = fclose(fp) == 0 && ok;
+    }
+    free(buf);
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tmp, path) == 0;
+#endif
+    if (!ok) remove(tmp);
+    return ok ? (long)(sizeof(h) + len) : -1;
+}
+
+// Chunk ids of backup name, in a malloc'd array. NULL if it cannot be read.
+static int *read_manifest(const char *dir, const char *name, ManifestHeader *h)
+{
+    char path[512];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%.*s.man", dir, SNAPSHOT_NAME_LEN - 1, name);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+    unsigned char *buf = NULL;
+    int *ids = NULL;
+    size_t len = 0;
+    if (fstat(fileno(fp), &st) == 0 && st.st_size >= (long long)sizeof(*h) &&
+        fread(h, sizeof(*h), 1, fp) == 1 && memcmp(h->magic, MANIFEST_MAGIC, 4) == 0 && h->chunks >= 0)
+    {
+        len = (size_t)st.st_size - sizeof(*h);
+        buf = malloc(len + 1);
+        ids = malloc(((size_t)h->chunks + 1) * sizeof(int));
+        if (buf && ids && fread(buf, 1, len, fp) == len)
+        {
+            const unsigned char *p = buf, *end = buf + len;
+            long long id = -1;
+            for (int i = 0; i < h->chunks; ++i) ids[i] = (int)(id += get_varint(&p, end));
+        }
+        else
+        {
+            free(ids);
+            ids = NULL;
+        }
+    }
+    free(buf);
+    fclose(fp);
+    return ids;
+}
+
+/* ---------------- Backing up ---------------- */
+
+static int append_catalog(const char *dir, const BackupInfo *b)
+{
+    char path[512];
+    backup_path(dir, BACKUP_CATALOG, path, sizeof(path));
+    FILE *fp = fopen(path, "a");
+    if (!fp) return 0;
+    fprintf(fp, "%s %lld %llu %d %d %d %lld\n", b->name, b->taken, b->generation, b->records, b->chunks,
+            b->new_chunks, b->bytes_written);
+    return fclose(fp) == 0;
+}
+
+static int parse_catalog_line(const char *line, BackupInfo *b)
+{
+    return sscanf(line, "%31s %lld %llu %d %d %d %lld", b->name, &b->taken, &b->generation, &b->records,
+                  &b->chunks, &b->new_chunks, &b->bytes_written) == 7;
+}
+
+// Whether dir's catalog lists a backup of name; *count receives how many
+// backups it lists. Caller holds BACKUP_LOCK.
+static int backup_taken(const char *dir, const char *name, int *count)
+{
+    char path[512], line[256];
+    BackupInfo b;
+    int taken = 0;
+    *count = 0;
+    backup_path(dir, BACKUP_CATALOG, path, sizeof(path));
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (!parse_catalog_line(line, &b)) continue;
+        ++*count;
+        taken = taken || strcmp(b.name, name) == 0;
+    }
+    fclose(fp);
+    return taken;
+}
+
+// Backs up snapshot name into dir, writing only the chunks no earlier
+// backup there has stored, and describes the backup in out if not NULL.
+// Returns STORE_OK, STORE_DUPLICATE (dir already has a backup of that
+// name) or STORE_ERROR.
+int backup_snapshot(const char *dir, const char *name, BackupInfo *out)
+{
+    Snapshot *snaps = malloc(MAX_SNAPSHOTS * sizeof(Snapshot)), snap;
+    int ns = snaps ? snapshot_list(snaps, MAX_SNAPSHOTS) : 0, found = 0;
+    for (int i = 0; i < ns; ++i)
+        if (strcmp(snaps[i].name, name) == 0)
+        {
+            snap = snaps[i];
+            found = 1;
+        }
+    free(snaps);
+    if (!found) return STORE_ERROR;
+    // An empty snapshot loads as NULL too; a missing or short file must not
+    // be backed up as one.
+    char path[512];
+    struct stat st;
+    int n;
+    Student *arr = snapshot_load(name, &n);
+    snapshot_path(name, path, sizeof(path));
+    if (n != snap.records || (!arr && stat(path, &st) != 0))
+    {
+        free(arr);
+        return STORE_ERROR;
+    }
+
+#ifdef _WIN32
+    _mkdir(dir);
+#else
+    mkdir(dir, 0755);
+#endif
+    backup_path(dir, BACKUP_LOCK, path, sizeof(path));
+    int lk = lock_store_file(path, 1);
+    if (lk < 0)
+    {
+        free(arr);
+        return STORE_ERROR;
+    }
+    // Checked under the lock, so two runs cannot both back up name.
+    int nbackups, taken = backup_taken(dir, name, &nbackups);
+    if (taken || nbackups >= MAX_BACKUPS)
+    {
+        unlock_store(lk);
+        free(arr);
+        return taken ? STORE_DUPLICATE : STORE_ERROR;
+    }
+
+    int nidx, r = STORE_ERROR, pack = -1, index = -1;
+    ChunkEntry *idx = read_index(dir, &nidx);
+    ChunkEntry *fresh = malloc(((size_t)n + 1) * sizeof(ChunkEntry));
+    int *ids = malloc(((size_t)n + 1) * sizeof(int));
+    int *starts = malloc(((size_t)n + 1) * sizeof(int));
+    ChunkTable table = {0};
+    ChunkSource src = {idx, nidx, NULL, fresh, starts, arr};
+    if (!fresh || !ids || !starts || !table_init(&table, (size_t)nidx + n)) goto done;
+    for (int i = 0; i < nidx; ++i) table_put(&table, table_free_slot(&table, idx[i].hash), idx[i].hash, i);
+    backup_path(dir, BACKUP_PACK, path, sizeof(path));
+    src.pack = nidx ? fopen(path, "rb") : NULL;
+    if (nidx && !src.pack) goto done;
+
+    // Pack bytes past the last indexed chunk were never committed.
+    unsigned long long end = nidx ? idx[nidx-1].offset + (unsigned long long)idx[nidx-1].count * sizeof(Student) : 0;
+    int nchunks = 0, nfresh = 0;
+    for (int start = 0, i = 0; i < n; ++i)
+    {
+        if (!chunk_ends_after(&arr[i], i - start + 1) && i < n - 1) continue;
+        int count = i - start + 1;
+        unsigned long long h = chunk_hash(&arr[start], count);
+        size_t slot = table_find(&table, &src, h, &arr[start], count);
+        if (table.ids[slot] < 0)
+        {
+            ChunkEntry *e = &fresh[nfresh];
+            memset(e, 0, sizeof(*e));
+            e->hash = h;
+            e->offset = end;
+            e->count = count;
+            end += (unsigned long long)count * sizeof(Student);
+            starts[nfresh] = start;
+            table_put(&table, slot, h, nidx + nfresh++);
+        }
+        ids[nchunks++] = table.ids[slot];
+        start = i + 1;
+    }
+
+    long long written = 0;
+    if (nfresh > 0)
+    {
+        backup_path(dir, BACKUP_PACK, path, sizeof(path));
+        pack = open(path, O_RDWR | O_CREAT | O_BINARY, 0644);
+        backup_path(dir, BACKUP_INDEX, path, sizeof(path));
+        index = open(path, O_RDWR | O_CREAT | O_BINARY, 0644);
+        if (pack < 0 || index < 0) goto done;
+        unsigned long long base = fresh[0].offset;
+        if (ftruncate(pack, (long long)base) != 0 || lseek(pack, (long long)base, SEEK_SET) < 0) goto done;
+        for (int k = 0; k < nfresh; ++k)
+        {
+            size_t bytes = (size_t)fresh[k].count * sizeof(Student);
+            if (write(pack, &arr[starts[k]], bytes) != (long)bytes) goto done;
+            written += (long long)bytes;
+        }
+        size_t bytes = (size_t)nfresh * sizeof(ChunkEntry);
+        if (fsync(pack) != 0 || ftruncate(index, (long long)nidx * sizeof(ChunkEntry)) != 0 ||
+            lseek(index, (long long)nidx * sizeof(ChunkEntry), SEEK_SET) < 0 ||
+            write(index, fresh, bytes) != (long)bytes || fsync(index) != 0)
+            goto done;
+        written += (long long)bytes;
+    }
+    long man = write_manifest(dir, &snap, ids, nchunks);
+    if (man < 0) goto done;
+
+    BackupInfo b = {0};
+    snprintf(b.name, sizeof(b.name), "%s", snap.name);
+    b.taken = snap.taken;
+    b.generation = snap.generation;
+    b.records = n;
+    b.chunks = nchunks;
+    b.new_chunks = nfresh;
+    b.bytes_written = written + man;
+    if (!append_catalog(dir, &b)) goto done;
+    if (out) *out = b;
+    r = STORE_OK;
+done:
+    if (src.pack) fclose(src.pack);
+    if (pack >= 0) close(pack);
+    if (index >= 0) close(index);
+    table_free(&table);
+    free(starts);
+    free(ids);
+    free(fresh);
+    free(idx);
+    free(arr);
+    unlock_store(lk);
+    return r;
+}
+
+// Backups in dir, oldest first.
+int backup_list(const char *dir, BackupInfo out[], int max)
+{
+    char path[512], line[256];
+    backup_path(dir, BACKUP_CATALOG, path, sizeof(path));
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+    int n = 0;
+    while (n < max && fgets(line, sizeof(line), fp))
+        if (parse_catalog_line(line, &out[n])) n++;
+    fclose(fp);
+    return n;
+}
+
+// Every record of backup name in dir, in a malloc'd array the caller
+// frees. Returns NULL (and *n = 0) if the backup is empty, missing or
+// damaged.
+Student *backup_load(const char *dir, const char *name, int *n)
+{
+    ManifestHeader h;
+    char path[512];
+    *n = 0;
+    int *ids = read_manifest(dir, name, &h);
+    if (!ids) return NULL;
+    int nidx;
+    ChunkEntry *idx = read_index(dir, &nidx);
+    backup_path(dir, BACKUP_PACK, path, sizeof(path));
+    FILE *fp = fopen(path, "rb");
+    Student *arr = malloc(((size_t)h.records + 1) * sizeof(Student));
+    int m = 0, ok = fp && arr && (idx || h.chunks == 0);
+    for (int i = 0; ok && i < h.chunks; ++i)
+    {
+        const ChunkEntry *e = ids[i] >= 0 && ids[i] < nidx ? &idx[ids[i]] : NULL;
+        ok = e && m + e->count <= h.records && fseek(fp, (long)e->offset, SEEK_SET) == 0 &&
+             fread(&arr[m], sizeof(Student), e->count, fp) == (size_t)e->count;
+        if (ok) m += e->count;
+    }
+    ok = ok && m == h.records;
+    if (fp) fclose(fp);
+    free(idx);
+    free(ids);
+    if (!ok)
+    {
+        free(arr);
+        return NULL;
+    }
+    *n = m;
+    return arr;
+}
@@ -0,0 +1,172 @@
+// cache.c
+// Result cache for repeated reports: statistics, sorted lists, top-N and
+// query results.
+//
+// Entries are keyed by a normalized report or query string and tagged
+// with the store generation they were computed from. A lookup hits only
+// when the tag equals the current generation, so any write (by this or
+// another process) invalidates the cached results; storing a result of a
+// new generation frees every entry of the old one at once. Memory is
+// bounded by CACHE_MAX_BYTES, evicting the least recently used entries.
+// One process-wide cache serves every thread of either front end.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#ifdef _WIN32
+#include <windows.h>
+#define sched_yield() SwitchToThread()
+#else
+#include <sched.h>
+#endif
+
+#include "student_store.h"
+
+#define CACHE_BUCKETS 64
+
+typedef struct CacheEntry
+{
+    struct CacheEntry *prev, *next; // LRU list, most recent first
+    struct CacheEntry *chain;       // hash bucket
+    char key[CACHE_KEY_LEN];
+    unsigned long long generation;
+    size_t size;
+    unsigned char data[];
+} CacheEntry;
+
+static struct
+{
+    CacheEntry *buckets[CACHE_BUCKETS];
+    CacheEntry *head, *tail;
+    unsigned long long generation; // of every entry
+    CacheStats stats;
+} cache;
+
+static atomic_flag cache_lock = ATOMIC_FLAG_INIT;
+
+static void lock(void)
+{
+    while (atomic_flag_test_and_set_explicit(&cache_lock, memory_order_acquire)) sched_yield();
+}
+
+static void unlock(void)
+{
+    atomic_flag_clear_explicit(&cache_lock, memory_order_release);
+}
+
+static CacheEntry **bucket_of(const char *key)
+{
+    unsigned int h = 2166136261u;
+    for (const char *p = key; *p; ++p) h = (h ^ (unsigned char)*p) * 16777619u;
+    return &cache.buckets[h % CACHE_BUCKETS];
+}
+
+static void lru_unlink(CacheEntry *e)
+{
+    if (e->prev) e->prev->next = e->next;
+    else cache.head = e->next;
+    if (e->next) e->next->prev = e->prev;
+    else cache.tail = e->prev;
+}
+
+static void lru_push_front(CacheEntry *e)
+{
+    e->prev = NULL;
+    e->next = cache.head;
+    if (cache.head) cache.head->prev = e;
+    cache.head = e;
+    if (!cache.tail) cache.tail = e;
+}
+
+static void drop(CacheEntry *e)
+{
+    CacheEntry **pp = bucket_of(e->key);
+    while (*pp != e) pp = &(*pp)->chain;
+    *pp = e->chain;
+    lru_unlink(e);
+    cache.stats.bytes -= e->size;
+    cache.stats.entries--;
+    free(e);
+}
+
+// Copies the result cached under key into out (at most cap bytes) if it
+// was computed at generation. Returns its size, or -1 on a miss.
+long cache_get(const char *key, unsigned long long generation, void *out, size_t cap)
+{
+    long got = -1;
+    lock();
+    for (CacheEntry *e = *bucket_of(key); e; e = e->chain)
+    {
+        if (strcmp(e->key, key) != 0) continue;
+        if (e->generation != generation)
+        {
+            drop(e); // stale: the roster has changed since
+            break;
+        }
+        if (e->size <= cap)
+        {
+            memcpy(out, e->data, e->size);
+            got = (long)e->size;
+            lru_unlink(e);
+            lru_push_front(e);
+        }
+        break;
+    }
+    if (got >= 0) cache.stats.hits++;
+    else cache.stats.misses++;
+    unlock();
+    return got;
+}
+
+// Remembers size bytes of data as the result for key at generation.
+// Results too big to leave room for others are not kept.
+void cache_put(const char *key, unsigned long long generation, const void *data, size_t size)
+{
+    if (strlen(key) >= CACHE_KEY_LEN || size > CACHE_MAX_BYTES / 4) return;
+    CacheEntry *fresh = malloc(sizeof(CacheEntry) + size);
+    if (!fresh) return;
+    snprintf(fresh->key, sizeof(fresh->key), "%s", key);
+    fresh->generation = generation;
+    fresh->size = size;
+    memcpy(fresh->data, data, size);
+
+    lock();
+    if (generation != cache.generation)
+    {
+        while (cache.head) drop(cache.head); // the old generation cannot hit again
+        cache.generation = generation;
+    }
+    for (CacheEntry *e = *bucket_of(key); e; e = e->chain)
+        if (strcmp(e->key, key) == 0)
+        {
+            drop(e);
+            break;
+        }
+    while (cache.tail && cache.stats.bytes + size > CACHE_MAX_BYTES)
+    {
+        drop(cache.tail);
+        cache.stats.evictions++;
+    }
+    CacheEntry **b = bucket_of(key);
+    fresh->chain = *b;
+    *b = fresh;
+    lru_push_front(fresh);
+    cache.stats.bytes += size;
+    cache.stats.entries++;
+    unlock();
+}
+
+void cache_clear(void)
+{
+    lock();
+    while (cache.head) drop(cache.head);
+    unlock();
+}
+
+void cache_stats(CacheStats *out)
+{
+    lock();
+    *out = cache.stats;
+    unlock();
+}
@@ -0,0 +1,293 @@
+// cdc.c
+// Change stream: every insert, update and delete, in commit order.
+//
+// CDC_FILE_NAME is an append-only array of fixed-size ChangeRecords, so
+// the record with sequence number s sits at offset (s - 1) * sizeof and a
+// consumer resumes from the last sequence it processed without scanning.
+//
+// The stream is written ahead of the roster. Under the exclusive lock a
+// writer calls cdc_begin, which appends and fsyncs the batch and records in
+// the lock file how to tell whether the roster change landed; then commits
+// FILE_NAME; then calls cdc_end, which moves the committed length in the
+// lock file past the batch, or cuts the batch off if the commit failed.
+// Readers see only committed changes. If a writer dies between cdc_begin
+// and cdc_end, the batch is pending: it counts as committed exactly when
+// its roster change landed, which for a rewrite means TMP_FILE_NAME was
+// renamed away and for an append means FILE_NAME grew by a whole record.
+// Readers apply that test without changing anything; the next exclusive
+// lock settles it for good (cdc_recover). So the stream holds every
+// committed change and no other, whenever a writer is killed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#define ftruncate _chsize
+#define fsync _commit
+#else
+#include <unistd.h>
+#endif
+
+#include "student_store.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+static int same_record(const Student *a, const Student *b)
+{
+    return a->roll == b->roll && a->marks == b->marks &&
+           strncmp(a->name, b->name, sizeof(a->name)) == 0 &&
+           strncmp(a->section, b->section, sizeof(a->section)) == 0 &&
+           strncmp(a->grade, b->grade, sizeof(a->grade)) == 0;
+}
+
+// Orders by roll, then by position so duplicate rolls pair up in file order.
+static int cmp_ptr_roll(const void *a, const void *b)
+{
+    const Student *x = *(const Student *const *)a, *y = *(const Student *const *)b;
+    if (x->roll != y->roll) return x->roll < y->roll ? -1 : 1;
+    return x < y ? -1 : x > y;
+}
+
+static const Student **sorted_by_roll(const Student arr[], int n)
+{
+    const Student **p = malloc((n > 0 ? n : 1) * sizeof(*p));
+    if (!p) return NULL;
+    for (int i = 0; i < n; ++i) p[i] = &arr[i];
+    qsort(p, n, sizeof(*p), cmp_ptr_roll);
+    return p;
+}
+
+static void put_change(ChangeRecord *c, int op, int pos, const Student *s, unsigned long long gen)
+{
+    memset(c, 0, sizeof(*c));
+    c->generation = gen;
+    c->op = op;
+    c->pos = pos;
+    c->rec = *s;
+}
+
+// Pairs the records of two versions of the roster by roll, then keeps the
+// pairs along a longest run whose new positions ascend, so a record that
+// only shifted needs no event and one that moved past others is deleted
+// and inserted again. partner[i] is the new position of old[i] if it is
+// kept, else -1; kept[j] says whether cur[j] is. Returns 0 if out of memory.
+static int match_records(const Student old[], int nold, const Student cur[], int ncur, int *partner,
+                         unsigned char *kept)
+{
+    const Student **a = sorted_by_roll(old, nold), **b = sorted_by_roll(cur, ncur);
+    int *tails = malloc((size_t)(nold > 0 ? nold : 1) * sizeof(int));
+    int *prev = malloc((size_t)(nold > 0 ? nold : 1) * sizeof(int));
+    int ok = a && b && tails && prev;
+    if (ok)
+    {
+        for (int i = 0; i < nold; ++i) partner[i] = -1;
+        for (int i = 0, j = 0; i < nold && j < ncur;)
+        {
+            if (a[i]->roll < b[j]->roll) ++i;
+            else if (b[j]->roll < a[i]->roll) ++j;
+            else partner[a[i++] - old] = (int)(b[j++] - cur);
+        }
+
+        int len = 0;
+        for (int i = 0; i < nold; ++i)
+        {
+            if (partner[i] < 0) continue;
+            int lo = 0, hi = len;
+            while (lo < hi)
+            {
+                int mid = (lo + hi) / 2;
+                if (partner[tails[mid]] < partner[i]) lo = mid + 1;
+                else hi = mid;
+            }
+            prev[i] = lo > 0 ? tails[lo - 1] : -1;
+            tails[lo] = i;
+            if (lo == len) ++len;
+        }
+        memset(kept, 0, (size_t)ncur);
+        for (int i = len > 0 ? tails[len - 1] : -1; i >= 0; i = prev[i]) kept[partner[i]] = 1;
+        for (int i = 0; i < nold; ++i)
+            if (partner[i] >= 0 && !kept[partner[i]]) partner[i] = -1;
+    }
+    free(a);
+    free(b);
+    free(tails);
+    free(prev);
+    return ok;
+}
+
+/* ---------------- Commit state ----------------
+ * Two lock file words: LOCK_WORD_CDC_COMMITTED, the number of committed
+ * changes, and LOCK_WORD_CDC_INTENT, how the pending batch commits: 0 for a
+ * rewrite, or 1 + the size FILE_NAME had before an append. A lock file
+ * from before the stream was written ahead has neither word, and all of
+ * its stream counts as committed.
+ */
+
+static unsigned long long stream_length(void)
+{
+    struct stat st;
+    return stat(CDC_FILE_NAME, &st) == 0 ? st.st_size / sizeof(ChangeRecord) : 0;
+}
+
+// Whether the roster change the pending batch describes is on disk.
+static int pending_landed(int lk)
+{
+    unsigned long long intent;
+    struct stat st;
+    if (!lock_word_get(lk, LOCK_WORD_CDC_INTENT, &intent)) return 1;
+    if (intent == 0) return stat(TMP_FILE_NAME, &st) != 0;
+    return stat(FILE_NAME, &st) == 0 && (unsigned long long)st.st_size >= intent - 1 + sizeof(Student);
+}
+
+// Committed changes, counting a pending batch whose roster change landed.
+// Caller holds the lock, shared or exclusive.
+static unsigned long long committed_length(int lk, unsigned long long *length)
+{
+    unsigned long long committed, n = stream_length();
+    if (length) *length = n;
+    if (!lock_word_get(lk, LOCK_WORD_CDC_COMMITTED, &committed) || committed >= n) return n;
+    return pending_landed(lk) ? n : committed;
+}
+
+static int truncate_stream(unsigned long long length)
+{
+    int fd = open(CDC_FILE_NAME, O_WRONLY | O_BINARY);
+    if (fd < 0) return length == 0;
+    int ok = ftruncate(fd, (long long)length * sizeof(ChangeRecord)) == 0 && fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+// Settles a batch left pending by a writer that died: keeps it if its
+// roster change landed and cuts it off otherwise, along with any torn
+// tail. Called by lock_store with the exclusive lock just taken.
+void cdc_recover(int lk)
+{
+    unsigned long long length, committed = committed_length(lk, &length);
+    struct stat st;
+    int torn = stat(CDC_FILE_NAME, &st) == 0 && (unsigned long long)st.st_size != length * sizeof(ChangeRecord);
+    unsigned long long stored;
+    if (committed < length || torn) truncate_stream(committed);
+    if (!lock_word_get(lk, LOCK_WORD_CDC_COMMITTED, &stored) || stored != committed)
+        lock_word_set(lk, LOCK_WORD_CDC_COMMITTED, committed);
+}
+
+/* ---------------- Writing ---------------- */
+
+// Appends the difference between two versions of the roster as a pending
+// batch ahead of the roster change, which is a rewrite if append_at < 0
+// and otherwise an append to a file of append_at bytes. The batch lists
+// deletes by descending position, then inserts by ascending position, then
+// updates, so applying them in order to a copy of old yields cur record
+// for record (replica.c relies on this). Caller holds the exclusive lock
+// and commits the change, then calls cdc_end. Returns the number of events
+// written, or -1 if the stream could not be written, in which case the
+// caller must not commit.
+int cdc_begin(int lk, const Student old[], int nold, const Student cur[], int ncur, unsigned long long generation,
+              long long append_at)
+{
+    int *partner = malloc((size_t)(nold > 0 ? nold : 1) * sizeof(int));
+    unsigned char *kept = malloc((size_t)(ncur > 0 ? ncur : 1));
+    ChangeRecord *out = malloc((size_t)(nold + ncur > 0 ? nold + ncur : 1) * sizeof(ChangeRecord));
+    int m = -1;
+    if (!partner || !kept || !out || !match_records(old, nold, cur, ncur, partner, kept)) goto done;
+
+    int base = append_at < 0 ? 0 : (int)(append_at / (long long)sizeof(Student));
+    m = 0;
+    for (int i = nold - 1; i >= 0; --i)
+        if (partner[i] < 0) put_change(&out[m++], CDC_DELETE, base + i, &old[i], generation);
+    for (int j = 0; j < ncur; ++j)
+        if (!kept[j]) put_change(&out[m++], CDC_INSERT, base + j, &cur[j], generation);
+    for (int i = 0; i < nold; ++i)
+        if (partner[i] >= 0 && !same_record(&old[i], &cur[partner[i]]))
+            put_change(&out[m++], CDC_UPDATE, base + partner[i], &cur[partner[i]], generation);
+    if (m == 0) goto done;
+
+    // cdc_recover left the stream at its committed length.
+    unsigned long long whole = stream_length();
+    int fd = -1;
+    if (!lock_word_set(lk, LOCK_WORD_CDC_COMMITTED, whole) ||
+        !lock_word_set(lk, LOCK_WORD_CDC_INTENT, append_at < 0 ? 0 : (unsigned long long)append_at + 1) ||
+        (fd = open(CDC_FILE_NAME, O_WRONLY | O_APPEND | O_CREAT | O_BINARY, 0644)) < 0)
+    {
+        fprintf(stderr, "Error: cannot write to %s\n", CDC_FILE_NAME);
+        m = -1;
+        goto done;
+    }
+    for (int k = 0; k < m; ++k) out[k].seq = whole + 1 + k;
+    size_t bytes = (size_t)m * sizeof(ChangeRecord);
+    CRASH_TORN("cdc:torn", fd, out, bytes);
+    if (write(fd, out, bytes) != (long)bytes || fsync(fd) != 0)
+    {
+        fprintf(stderr, "Error: cannot write to %s\n", CDC_FILE_NAME);
+        truncate_stream(whole);
+        m = -1;
+    }
+    close(fd);
+done:
+    free(partner);
+    free(kept);
+    free(out);
+    return m;
+}
+
+// Ends the batch cdc_begin wrote: commits it if the roster change was
+// committed, or cuts it off if not. Returns 1, or 0 if the stream could not
+// be updated; the roster change stands either way, and the next exclusive
+// lock settles the batch from what is on disk.
+int cdc_end(int lk, int committed)
+{
+    unsigned long long length, done;
+    if (!lock_word_get(lk, LOCK_WORD_CDC_COMMITTED, &done)) return 1; // nothing was begun
+    length = stream_length();
+    if (done >= length) return 1;
+    int ok = committed ? lock_word_set(lk, LOCK_WORD_CDC_COMMITTED, length) : truncate_stream(done);
+    if (!ok) fprintf(stderr, "Error: cannot update %s\n", CDC_FILE_NAME);
+    return ok;
+}
+
+// Reads up to max changes starting at sequence number from_seq (1 is the
+// first ever). Returns how many were read; 0 means the consumer is caught
+// up. A consumer stores the last seq it handled and passes seq + 1 next.
+int cdc_read(unsigned long long from_seq, ChangeRecord out[], int max)
+{
+    if (from_seq == 0) from_seq = 1;
+    int lk = lock_store(0);
+    unsigned long long committed = lk >= 0 ? committed_length(lk, NULL) : 0;
+    if (from_seq > committed) max = 0;
+    else if ((unsigned long long)max > committed - from_seq + 1) max = (int)(committed - from_seq + 1);
+    FILE *fp = max > 0 ? fopen(CDC_FILE_NAME, "rb") : NULL;
+    int n = 0;
+    if (fp)
+    {
+        if (fseek(fp, (long)((from_seq - 1) * sizeof(ChangeRecord)), SEEK_SET) == 0)
+            n = (int)fread(out, sizeof(ChangeRecord), max, fp);
+        fclose(fp);
+    }
+    unlock_store(lk);
+    // A torn tail never carries the sequence number its position implies.
+    for (int k = 0; k < n; ++k)
+        if (out[k].seq != from_seq + k) return k;
+    return n;
+}
+
+// Sequence number of the newest committed change, 0 if there are none.
+unsigned long long cdc_last_seq(void)
+{
+    int lk = lock_store(0);
+    unsigned long long n = lk >= 0 ? committed_length(lk, NULL) : 0;
+    unlock_store(lk);
+    return n;
+}
+
+// cdc_last_seq for a caller that already holds lk, so the answer agrees
+// with whatever else it reads under that lock.
+unsigned long long cdc_last_seq_locked(int lk)
+{
+    return committed_length(lk, NULL);
+}
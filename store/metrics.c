@@ -0,0 +1,213 @@
+// metrics.c
+// Per-operation counters and latency histograms for the store and the
+// front ends.
+//
+// Each thread records into its own buffer (no locks, no shared cache lines
+// on the hot path); buffers are pushed once onto a lock-free list and summed
+// when a report is produced. Latencies go into HDR-style buckets: four
+// sub-buckets per power of two of nanoseconds, i.e. better than 25%
+// resolution from 1 ns to centuries in 256 counters.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "student_store.h"
+
+int metrics_enabled = 0;
+
+static const char *metric_names[M_COUNT] = {
+    "load", "save", "append", "query", "sort", "top_n", "statistics", "list_populate", "first_query",
+    "replica_lag", "rank"
+};
+
+typedef struct MetricsBuffer
+{
+    OpMetric ops[M_COUNT];
+    struct MetricsBuffer *next;
+} MetricsBuffer;
+
+static _Atomic(MetricsBuffer *) all_buffers = NULL;
+static _Thread_local MetricsBuffer *my_buffer = NULL;
+
+static MetricsBuffer *thread_buffer(void)
+{
+    if (!my_buffer)
+    {
+        my_buffer = calloc(1, sizeof(MetricsBuffer));
+        if (!my_buffer) return NULL;
+        MetricsBuffer *head = atomic_load(&all_buffers);
+        do my_buffer->next = head;
+        while (!atomic_compare_exchange_weak(&all_buffers, &head, my_buffer));
+    }
+    return my_buffer;
+}
+
+static unsigned long long clock_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (unsigned long long)(now.QuadPart * (1e9 / freq.QuadPart));
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static int bucket_of(unsigned long long ns)
+{
+    if (ns < 4) return (int)ns;
+    int k = 63 - __builtin_clzll(ns);
+    return k * 4 + (int)((ns >> (k - 2)) & 3);
+}
+
+// Largest latency that falls into bucket b.
+static unsigned long long bucket_upper(int b)
+{
+    if (b < 4) return (unsigned long long)b;
+    int k = b / 4, sub = b % 4;
+    return ((unsigned long long)(5 + sub) << (k - 2)) - 1;
+}
+
+#ifndef SMS_NO_METRICS
+unsigned long long metrics_start(void)
+{
+    return metrics_enabled ? clock_ns() : 0;
+}
+
+void metrics_end(int op, unsigned long long start, unsigned long long bytes)
+{
+    if (start) metrics_record(op, clock_ns() - start, bytes);
+}
+
+void metrics_record(int op, unsigned long long ns, unsigned long long bytes)
+{
+    if (!metrics_enabled) return;
+    MetricsBuffer *buf = thread_buffer();
+    if (!buf) return;
+    OpMetric *m = &buf->ops[op];
+    m->count++;
+    m->total_ns += ns;
+    m->bytes += bytes;
+    m->buckets[bucket_of(ns)]++;
+}
+#endif
+
+// Sums every thread's buffer into out[M_COUNT].
+void metrics_snapshot(OpMetric out[])
+{
+    memset(out, 0, sizeof(OpMetric) * M_COUNT);
+    for (MetricsBuffer *b = atomic_load(&all_buffers); b; b = b->next)
+    {
+        for (int op = 0; op < M_COUNT; ++op)
+        {
+            out[op].count += b->ops[op].count;
+            out[op].total_ns += b->ops[op].total_ns;
+            out[op].bytes += b->ops[op].bytes;
+            for (int k = 0; k < METRIC_BUCKETS; ++k) out[op].buckets[k] += b->ops[op].buckets[k];
+        }
+    }
+}
+
+// Latency (ns) below which a fraction q of the samples fall.
+static unsigned long long quantile_ns(const OpMetric *m, double q)
+{
+    unsigned long long want = (unsigned long long)(q * m->count + 0.5), seen = 0;
+    if (want == 0) want = 1;
+    for (int k = 0; k < METRIC_BUCKETS; ++k)
+    {
+        seen += m->buckets[k];
+        if (seen >= want) return bucket_upper(k);
+    }
+    return 0;
+}
+
+void metrics_print(FILE *fp)
+{
+    static OpMetric snap[M_COUNT];
+    if (!metrics_enabled)
+    {
+        fprintf(fp, "Metrics are disabled (unset SMS_METRICS or set it to 1 to enable).\n");
+        return;
+    }
+    metrics_snapshot(snap);
+    fprintf(fp, "%-14s %8s %10s %10s %10s %10s %12s\n",
+            "operation", "count", "avg us", "p50 us", "p99 us", "max us", "bytes");
+    for (int op = 0; op < M_COUNT; ++op)
+    {
+        const OpMetric *m = &snap[op];
+        if (!m->count) continue;
+        unsigned long long max = 0;
+        for (int k = METRIC_BUCKETS - 1; k >= 0 && !max; --k)
+            if (m->buckets[k]) max = bucket_upper(k);
+        fprintf(fp, "%-14s %8llu %10.1f %10.1f %10.1f %10.1f %12llu\n", metric_names[op], m->count,
+                m->total_ns / 1e3 / m->count, quantile_ns(m, 0.5) / 1e3, quantile_ns(m, 0.99) / 1e3,
+                max / 1e3, m->bytes);
+    }
+    CacheStats cs;
+    cache_stats(&cs);
+    if (cs.hits + cs.misses)
+        fprintf(fp, "result cache: %llu hits, %llu misses, %llu evicted, %d entries, %zu bytes\n",
+                cs.hits, cs.misses, cs.evictions, cs.entries, cs.bytes);
+}
+
+// Writes the metrics in Prometheus text exposition format.
+int metrics_write_prometheus(const char *path)
+{
+    static OpMetric snap[M_COUNT];
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return 0;
+    metrics_snapshot(snap);
+    fprintf(fp, "# HELP sms_op_seconds Latency of store and UI operations.\n");
+    fprintf(fp, "# TYPE sms_op_seconds histogram\n");
+    for (int op = 0; op < M_COUNT; ++op)
+    {
+        const OpMetric *m = &snap[op];
+        unsigned long long cum = 0;
+        int k = 0;
+        for (int p = 10; p <= 34; ++p) // le = 2^p ns, about 1 us to 17 s
+        {
+            for (; k < METRIC_BUCKETS && bucket_upper(k) < (1ULL << p); ++k) cum += m->buckets[k];
+            fprintf(fp, "sms_op_seconds_bucket{op=\"%s\",le=\"%.9g\"} %llu\n",
+                    metric_names[op], (double)(1ULL << p) / 1e9, cum);
+        }
+        fprintf(fp, "sms_op_seconds_bucket{op=\"%s\",le=\"+Inf\"} %llu\n", metric_names[op], m->count);
+        fprintf(fp, "sms_op_seconds_sum{op=\"%s\"} %.9f\n", metric_names[op], m->total_ns / 1e9);
+        fprintf(fp, "sms_op_seconds_count{op=\"%s\"} %llu\n", metric_names[op], m->count);
+    }
+    fprintf(fp, "# HELP sms_op_bytes_total Bytes read or written by store operations.\n");
+    fprintf(fp, "# TYPE sms_op_bytes_total counter\n");
+    for (int op = 0; op < M_COUNT; ++op)
+        fprintf(fp, "sms_op_bytes_total{op=\"%s\"} %llu\n", metric_names[op], snap[op].bytes);
+    int ok = fclose(fp) == 0;
+    return ok && rename(tmp, path) == 0;
+}
+
+static void metrics_at_exit(void)
+{
+    const char *prom = getenv("SMS_METRICS_PROM");
+    const char *mode = getenv("SMS_METRICS");
+    if (mode && strcmp(mode, "1") == 0) metrics_print(stderr);
+    if (prom && *prom && !metrics_write_prometheus(prom))
+        fprintf(stderr, "Error: cannot write metrics to %s\n", prom);
+}
+
+// SMS_METRICS=0 turns collection off, SMS_METRICS=1 also dumps a report to
+// stderr on exit, and SMS_METRICS_PROM=path writes Prometheus text on exit.
+void metrics_init(void)
+{
+    const char *mode = getenv("SMS_METRICS");
+    metrics_enabled = !(mode && strcmp(mode, "0") == 0);
+    if (metrics_enabled) atexit(metrics_at_exit);
+}
@@ -0,0 +1,115 @@
+// pager.c
+// On-demand, page-at-a-time reads of the records file with an LRU cache.
+//
+// A page is PAGE_RECORDS consecutive records. pager_get serves cached pages
+// without touching the file; a miss takes the shared lock, and if the
+// generation moved since the cache was filled (another save or insert) the
+// whole cache and the record count are refreshed first, so a page never
+// mixes two versions of the file. The file is opened per miss rather than
+// held open, which would block the rename in save_all_students on Windows.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "student_store.h"
+
+typedef struct
+{
+    int page;                     // -1 when empty
+    int n;                        // records in this page
+    unsigned long long last_used; // LRU stamp
+    Student recs[PAGE_RECORDS];
+} PageSlot;
+
+struct PagedReader
+{
+    int count;
+    unsigned long long generation;
+    unsigned long long clock;
+    int nslots;
+    PageSlot slots[];
+};
+
+static void refresh(PagedReader *pr, int lk)
+{
+    struct stat st;
+    pr->count = stat(FILE_NAME, &st) == 0 ? (int)(st.st_size / sizeof(Student)) : 0;
+    pr->generation = lk >= 0 ? store_generation_locked(lk) : 0;
+    for (int i = 0; i < pr->nslots; ++i) pr->slots[i].page = -1;
+}
+
+PagedReader *pager_open(int cache_pages)
+{
+    if (cache_pages <= 0) cache_pages = PAGE_CACHE_PAGES;
+    PagedReader *pr = malloc(sizeof(PagedReader) + cache_pages * sizeof(PageSlot));
+    if (!pr) return NULL;
+    pr->nslots = cache_pages;
+    pr->clock = 0;
+    int lk = lock_store(0);
+    refresh(pr, lk);
+    unlock_store(lk);
+    return pr;
+}
+
+int pager_count(const PagedReader *pr)
+{
+    return pr->count;
+}
+
+// Generation of the file the cached pages and the count come from.
+unsigned long long pager_generation(const PagedReader *pr)
+{
+    return pr->generation;
+}
+
+// Reads page into the least recently used slot. Caller holds the lock.
+static PageSlot *fill_slot(PagedReader *pr, int page)
+{
+    PageSlot *victim = &pr->slots[0];
+    for (int i = 1; i < pr->nslots && victim->page != -1; ++i)
+        if (pr->slots[i].page == -1 || pr->slots[i].last_used < victim->last_used) victim = &pr->slots[i];
+
+    unsigned long long t0 = metrics_start();
+    FILE *fp = fopen(FILE_NAME, "rb");
+    if (!fp) return NULL;
+    int n = 0;
+    if (fseek(fp, (long)page * PAGE_RECORDS * (long)sizeof(Student), SEEK_SET) == 0)
+        n = (int)fread(victim->recs, sizeof(Student), PAGE_RECORDS, fp);
+    fclose(fp);
+    metrics_end(M_LOAD, t0, (unsigned long long)n * sizeof(Student));
+    if (n == 0) return NULL;
+    victim->page = page;
+    victim->n = n;
+    return victim;
+}
+
+// Record at index, or NULL past the end. The pointer stays valid until the
+// next pager_get or pager_close.
+const Student *pager_get(PagedReader *pr, int index)
+{
+    if (index < 0 || index >= pr->count) return NULL;
+    int page = index / PAGE_RECORDS, off = index % PAGE_RECORDS;
+    PageSlot *slot = NULL;
+    for (int i = 0; i < pr->nslots; ++i)
+        if (pr->slots[i].page == page)
+        {
+            slot = &pr->slots[i];
+            break;
+        }
+    if (!slot)
+    {
+        int lk = lock_store(0);
+        if (lk >= 0 && store_generation_locked(lk) != pr->generation) refresh(pr, lk);
+        slot = index < pr->count ? fill_slot(pr, page) : NULL;
+        unlock_store(lk);
+        if (!slot) return NULL;
+    }
+    slot->last_used = ++pr->clock;
+    return off < slot->n ? &slot->recs[off] : NULL;
+}
+
+void pager_close(PagedReader *pr)
+{
+    free(pr);
+}
@@ -0,0 +1,356 @@
+// partition.c
+// Archived terms: read-only compressed archives plus a catalog, and
+// queries that span them.
+//
+// FILE_NAME holds only the current term. archive_term moves its records
+// into a compressed archive, ARCHIVE_DIR/<name>.sma (see archive.c), and
+// adds a catalog line with the term's roll range, marks range and a 64-bit
+// mask of the sections present. A query over all terms skips every
+// archived term whose metadata rules out a match and scans the rest on
+// parallel threads, inflating only the archive blocks it needs, so years
+// of history cost neither current-term operations nor unrelated queries.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/stat.h>
+#include <stdatomic.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "student_store.h"
+
+#define MAX_SCAN_THREADS 16
+
+/* ---------------- Catalog ---------------- */
+
+// Bit of a section in Partition.section_mask.
+unsigned long long section_bit(const char *section)
+{
+    unsigned int h = 2166136261u; // FNV-1a, as in group_by_section
+    for (int i = 0; i < 10 && section[i]; ++i) h = (h ^ (unsigned char)section[i]) * 16777619u;
+    return 1ULL << (h % 64);
+}
+
+static void archive_path(const char *name, char *out, int size)
+{
+    snprintf(out, size, "%s/%.*s.sma", ARCHIVE_DIR, PARTITION_NAME_LEN - 1, name);
+}
+
+// Reads the catalog; returns the number of archived terms. Caller holds
+// the store lock (shared is enough).
+static int read_catalog(Partition out[], int max)
+{
+    FILE *fp = fopen(CATALOG_FILE, "r");
+    if (!fp) return 0;
+    int n = 0;
+    char line[256];
+    while (n < max && fgets(line, sizeof(line), fp))
+    {
+        Partition *p = &out[n];
+        if (sscanf(line, "%31s %d %d %d %f %f %llx", p->name, &p->count, &p->roll_min, &p->roll_max,
+                   &p->marks_min, &p->marks_max, &p->section_mask) == 7)
+            n++;
+    }
+    fclose(fp);
+    return n;
+}
+
+// Replaces the catalog atomically. Caller holds the exclusive lock.
+static int write_catalog(const Partition parts[], int n)
+{
+    char tmp[64];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", CATALOG_FILE);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return 0;
+    for (int i = 0; i < n; ++i)
+    {
+        const Partition *p = &parts[i];
+        fprintf(fp, "%s %d %d %d %.9g %.9g %llx\n", p->name, p->count, p->roll_min, p->roll_max,
+                p->marks_min, p->marks_max, p->section_mask);
+    }
+    int ok = fclose(fp) == 0;
+#ifdef _WIN32
+    return ok && MoveFileExA(tmp, CATALOG_FILE, MOVEFILE_REPLACE_EXISTING);
+#else
+    return ok && rename(tmp, CATALOG_FILE) == 0;
+#endif
+}
+
+int load_catalog(Partition out[], int max)
+{
+    int lk = lock_store(0);
+    int n = read_catalog(out, max);
+    unlock_store(lk);
+    return n;
+}
+
+/* ---------------- Archiving ---------------- */
+
+static int valid_term_name(const char *name)
+{
+    int len = (int)strlen(name);
+    if (len == 0 || len >= PARTITION_NAME_LEN) return 0;
+    for (int i = 0; i < len; ++i)
+        if (!isalnum((unsigned char)name[i]) && !strchr("-_.", name[i])) return 0;
+    return name[0] != '.';
+}
+
+static void describe(Partition *p, const char *name, const Student arr[], int n)
+{
+    memset(p, 0, sizeof(*p));
+    strcpy(p->name, name);
+    p->count = n;
+    p->roll_min = p->roll_max = arr[0].roll;
+    p->marks_min = p->marks_max = arr[0].marks;
+    for (int i = 0; i < n; ++i)
+    {
+        if (arr[i].roll < p->roll_min) p->roll_min = arr[i].roll;
+        if (arr[i].roll > p->roll_max) p->roll_max = arr[i].roll;
+        if (arr[i].marks < p->marks_min) p->marks_min = arr[i].marks;
+        if (arr[i].marks > p->marks_max) p->marks_max = arr[i].marks;
+        p->section_mask |= section_bit(arr[i].section);
+    }
+}
+
+// Removes term name from the catalog and deletes its archive.
+static void drop_term(const char *name)
+{
+    Partition parts[MAX_PARTITIONS];
+    char path[64];
+    int lk = lock_store(1);
+    int n = read_catalog(parts, MAX_PARTITIONS), m = 0;
+    for (int i = 0; i < n; ++i)
+        if (strcmp(parts[i].name, name) != 0) parts[m++] = parts[i];
+    write_catalog(parts, m);
+    archive_path(name, path, sizeof(path));
+    remove(path);
+    unlock_store(lk);
+}
+
+// Moves every current record into a new read-only term called name, leaving
+// the current roster empty. The term is catalogued before the roster is
+// cleared, so a crash in between leaves the records in both places rather
+// than in neither. Returns STORE_OK, STORE_DUPLICATE (name taken),
+// STORE_CONFLICT (roster changed meanwhile) or STORE_ERROR.
+int archive_term(const char *name)
+{
+    Partition parts[MAX_PARTITIONS];
+    char path[64];
+    if (!valid_term_name(name))
+    {
+        fprintf(stderr, "Error: term names use letters, digits, '-', '_' and '.'\n");
+        return STORE_ERROR;
+    }
+    int n;
+    Student *arr = load_all_students(&n);
+    if (n == 0)
+    {
+        free(arr);
+        return STORE_ERROR;
+    }
+    unsigned long long gen = loaded_generation;
+
+    int lk = lock_store(1);
+    if (lk < 0)
+    {
+        free(arr);
+        return STORE_ERROR;
+    }
+    int r = STORE_OK;
+    int np = read_catalog(parts, MAX_PARTITIONS);
+    for (int i = 0; i < np; ++i)
+        if (strcmp(parts[i].name, name) == 0) r = STORE_DUPLICATE;
+    if (r == STORE_OK && np == MAX_PARTITIONS) r = STORE_ERROR;
+    if (r == STORE_OK && store_generation_locked(lk) != gen) r = STORE_CONFLICT;
+    if (r == STORE_OK)
+    {
+#ifdef _WIN32
+        _mkdir(ARCHIVE_DIR);
+#else
+        mkdir(ARCHIVE_DIR, 0755);
+#endif
+        archive_path(name, path, sizeof(path));
+        describe(&parts[np], name, arr, n);
+        if (archive_write(path, arr, n, ARCHIVE_LEVEL) != STORE_OK) r = STORE_ERROR;
+        else if (!write_catalog(parts, np + 1))
+        {
+            remove(path);
+            r = STORE_ERROR;
+        }
+    }
+    unlock_store(lk);
+
+    if (r == STORE_OK)
+    {
+        r = save_all_students(arr, 0);
+        if (r != STORE_OK) drop_term(name);
+    }
+    free(arr);
+    return r;
+}
+
+/* ---------------- Cross-term queries ---------------- */
+
+// False when the term's metadata proves no record can satisfy pr.
+static int range_may_match(double lo, double hi, int op, double v)
+{
+    switch (op)
+    {
+    case OP_EQ: return lo <= v && v <= hi;
+    case OP_NE: return !(lo == v && hi == v);
+    case OP_LT: return lo < v;
+    case OP_LE: return lo <= v;
+    case OP_GT: return hi > v;
+    default: return hi >= v;
+    }
+}
+
+int partition_may_match(const Partition *p, const Query *q)
+{
+    for (int k = 0; k < q->npreds; ++k)
+    {
+        const Predicate *pr = &q->preds[k];
+        if (pr->field == F_ROLL && !range_may_match(p->roll_min, p->roll_max, pr->op, pr->num)) return 0;
+        if (pr->field == F_MARKS && !range_may_match(p->marks_min, p->marks_max, pr->op, pr->num)) return 0;
+        if (pr->field == F_SECTION && pr->op == OP_EQ && !(p->section_mask & section_bit(pr->str))) return 0;
+    }
+    return 1;
+}
+
+typedef struct
+{
+    const Student *recs;
+    int n;
+    Student *hits; // malloc'd matches
+    int nhits;
+    char archive[64]; // compressed archive to query instead, if set
+} ScanTask;
+
+typedef struct
+{
+    ScanTask *tasks;
+    int ntasks;
+    const Query *q;
+    atomic_int next;
+} ScanJob;
+
+static void scan_one(ScanTask *t, const Query *q)
+{
+    if (t->archive[0])
+    {
+        ArchiveReader *a = archive_open(t->archive);
+        int cap = 0;
+        if (!a || archive_query(a, q, &t->hits, &t->nhits, &cap) < 0)
+            fprintf(stderr, "Error: cannot read %s\n", t->archive);
+        archive_close(a);
+        return;
+    }
+    int cap = 64;
+    t->hits = malloc(sizeof(Student) * cap);
+    for (int i = 0; i < t->n && t->hits; ++i)
+    {
+        if (!query_match(&t->recs[i], q)) continue;
+        if (t->nhits == cap)
+        {
+            Student *grown = realloc(t->hits, sizeof(Student) * (cap *= 2));
+            if (!grown) break;
+            t->hits = grown;
+        }
+        t->hits[t->nhits++] = t->recs[i];
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI scan_worker(LPVOID arg)
+#else
+static void *scan_worker(void *arg)
+#endif
+{
+    ScanJob *job = arg;
+    int i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->ntasks) scan_one(&job->tasks[i], job->q);
+    return 0;
+}
+
+static int cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+// Runs q over the current roster and every archived term it could match.
+// Returns a malloc'd array of the results (ordered and limited as q asks)
+// and their number in *n; *pruned, if given, receives how many terms the
+// catalog let us skip.
+Student *query_all_terms(const Query *q, int *n, int *pruned)
+{
+    Partition parts[MAX_PARTITIONS];
+    ScanTask tasks[MAX_PARTITIONS + 1];
+    *n = 0;
+    if (pruned) *pruned = 0;
+
+    int ncur;
+    Student *cur = load_all_students(&ncur);
+    int np = load_catalog(parts, MAX_PARTITIONS), nt = 0;
+    memset(&tasks[nt], 0, sizeof(ScanTask));
+    tasks[nt].recs = cur;
+    tasks[nt++].n = ncur;
+    for (int i = 0; i < np; ++i)
+    {
+        if (!partition_may_match(&parts[i], q))
+        {
+            if (pruned) (*pruned)++;
+            continue;
+        }
+        memset(&tasks[nt], 0, sizeof(ScanTask));
+        archive_path(parts[i].name, tasks[nt].archive, sizeof(tasks[nt].archive));
+        nt++;
+    }
+
+    ScanJob job = { tasks, nt, q, 0 };
+    int nthreads = cpu_count();
+    if (nthreads > nt) nthreads = nt;
+    if (nthreads > MAX_SCAN_THREADS) nthreads = MAX_SCAN_THREADS;
+#ifdef _WIN32
+    HANDLE threads[MAX_SCAN_THREADS];
+    int started = 0;
+    for (; started < nthreads - 1; ++started)
+        if (!(threads[started] = CreateThread(NULL, 0, scan_worker, &job, 0, NULL))) break;
+    scan_worker(&job); // this thread helps too, and finishes the work if no thread started
+    WaitForMultipleObjects(started, threads, TRUE, INFINITE);
+    for (int i = 0; i < started; ++i) CloseHandle(threads[i]);
+#else
+    pthread_t threads[MAX_SCAN_THREADS];
+    int started = 0;
+    for (; started < nthreads - 1; ++started)
+        if (pthread_create(&threads[started], NULL, scan_worker, &job) != 0) break;
+    scan_worker(&job);
+    for (int i = 0; i < started; ++i) pthread_join(threads[i], NULL);
+#endif
+
+    long long total = 0;
+    for (int i = 0; i < nt; ++i) total += tasks[i].nhits;
+    Student *out = malloc(sizeof(Student) * (total > 0 ? total : 1));
+    for (int i = 0; i < nt; ++i)
+    {
+        if (out && tasks[i].nhits) memcpy(out + *n, tasks[i].hits, sizeof(Student) * tasks[i].nhits);
+        if (out) *n += tasks[i].nhits;
+        free(tasks[i].hits);
+    }
+    free(cur);
+    if (out) *n = run_query(out, *n, q); // ordering and limit over the merged hits
+    return out;
+}
@@ -0,0 +1,307 @@
+// query.c
+// Ad-hoc query language over Student fields.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "student_store.h"
+
+/* Queries such as
+ *     section == "A" && marks >= 75 order by marks desc limit 20
+ * are compiled into a list of predicates plus optional ordering and limit.
+ * Execution is a selection-vector scan: the most selective predicate (roll
+ * equality, then numeric, then string tests) runs over every record and each
+ * following predicate only over the surviving row numbers.
+ */
+
+static const char *field_names[] = { "roll", "name", "section", "marks", "grade" };
+
+static const char *skip_spaces(const char *p)
+{
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+// Copies the next identifier/number/quoted string into tok. Returns new position.
+static const char *next_token(const char *p, char *tok, int size)
+{
+    int len = 0;
+    p = skip_spaces(p);
+    if (*p == '"' || *p == '\'')
+    {
+        char quote = *p++;
+        while (*p && *p != quote && len < size - 1) tok[len++] = *p++;
+        if (*p == quote) p++;
+    }
+    else if (strchr("=!<>&", *p) && *p)
+    {
+        while (*p && strchr("=!<>&", *p) && len < size - 1) tok[len++] = *p++;
+    }
+    else
+    {
+        while (*p && !strchr(" \t=!<>&\"'", *p) && len < size - 1) tok[len++] = *p++;
+    }
+    tok[len] = '\0';
+    return p;
+}
+
+static int parse_field(const char *tok)
+{
+    for (int f = 0; f < F_NONE; ++f)
+        if (strcmp(tok, field_names[f]) == 0) return f;
+    return F_NONE;
+}
+
+static int parse_op(const char *tok)
+{
+    if (strcmp(tok, "==") == 0 || strcmp(tok, "=") == 0) return OP_EQ;
+    if (strcmp(tok, "!=") == 0) return OP_NE;
+    if (strcmp(tok, "<") == 0) return OP_LT;
+    if (strcmp(tok, "<=") == 0) return OP_LE;
+    if (strcmp(tok, ">") == 0) return OP_GT;
+    if (strcmp(tok, ">=") == 0) return OP_GE;
+    return -1;
+}
+
+// Compiles text into q. Returns 1 on success; on failure err describes why.
+int compile_query(const char *text, Query *q, char *err, int errsize)
+{
+    char tok[64];
+    const char *p = text;
+    memset(q, 0, sizeof(*q));
+    q->order_field = F_NONE;
+
+    p = next_token(p, tok, sizeof(tok));
+    while (tok[0] != '\0' && strcmp(tok, "order") != 0 && strcmp(tok, "limit") != 0)
+    {
+        if (q->npreds == MAX_PREDICATES)
+        {
+            snprintf(err, errsize, "too many conditions (max %d)", MAX_PREDICATES);
+            return 0;
+        }
+        Predicate *pr = &q->preds[q->npreds++];
+        pr->field = parse_field(tok);
+        if (pr->field == F_NONE)
+        {
+            snprintf(err, errsize, "unknown field '%s'", tok);
+            return 0;
+        }
+        p = next_token(p, tok, sizeof(tok));
+        pr->op = parse_op(tok);
+        if (pr->op < 0)
+        {
+            snprintf(err, errsize, "expected comparison after '%s'", field_names[pr->field]);
+            return 0;
+        }
+        p = next_token(p, tok, sizeof(tok));
+        if (tok[0] == '\0')
+        {
+            snprintf(err, errsize, "missing value for '%s'", field_names[pr->field]);
+            return 0;
+        }
+        if (pr->field == F_ROLL || pr->field == F_MARKS)
+        {
+            if (sscanf(tok, "%lf", &pr->num) != 1)
+            {
+                snprintf(err, errsize, "'%s' is not a number", tok);
+                return 0;
+            }
+            if (pr->field == F_MARKS) pr->num = (float)pr->num; // compare as stored, so marks == 75.1 matches
+        }
+        else
+        {
+            snprintf(pr->str, sizeof(pr->str), "%.*s", (int)sizeof(pr->str) - 1, tok);
+        }
+        p = next_token(p, tok, sizeof(tok));
+        if (strcmp(tok, "&&") == 0 || strcmp(tok, "and") == 0) p = next_token(p, tok, sizeof(tok));
+        else if (tok[0] != '\0' && strcmp(tok, "order") != 0 && strcmp(tok, "limit") != 0)
+        {
+            snprintf(err, errsize, "expected '&&', 'order by' or 'limit' near '%s'", tok);
+            return 0;
+        }
+    }
+    if (strcmp(tok, "order") == 0)
+    {
+        p = next_token(p, tok, sizeof(tok));
+        if (strcmp(tok, "by") != 0)
+        {
+            snprintf(err, errsize, "expected 'by' after 'order'");
+            return 0;
+        }
+        p = next_token(p, tok, sizeof(tok));
+        q->order_field = parse_field(tok);
+        if (q->order_field == F_NONE)
+        {
+            snprintf(err, errsize, "cannot order by '%s'", tok);
+            return 0;
+        }
+        p = next_token(p, tok, sizeof(tok));
+        if (strcmp(tok, "desc") == 0 || strcmp(tok, "asc") == 0)
+        {
+            q->order_desc = strcmp(tok, "desc") == 0;
+            p = next_token(p, tok, sizeof(tok));
+        }
+    }
+    if (strcmp(tok, "limit") == 0)
+    {
+        p = next_token(p, tok, sizeof(tok));
+        if (sscanf(tok, "%d", &q->limit) != 1 || q->limit <= 0)
+        {
+            snprintf(err, errsize, "limit must be a positive number");
+            return 0;
+        }
+        p = next_token(p, tok, sizeof(tok));
+    }
+    if (tok[0] != '\0')
+    {
+        snprintf(err, errsize, "unexpected '%s'", tok);
+        return 0;
+    }
+    return 1;
+}
+
+static int compare_values(double a, double b, int op)
+{
+    switch (op)
+    {
+    case OP_EQ: return a == b;
+    case OP_NE: return a != b;
+    case OP_LT: return a < b;
+    case OP_LE: return a <= b;
+    case OP_GT: return a > b;
+    default: return a >= b;
+    }
+}
+
+static int match_predicate(const Student *s, const Predicate *pr)
+{
+    switch (pr->field)
+    {
+    case F_ROLL: return compare_values(s->roll, pr->num, pr->op);
+    case F_MARKS: return compare_values(s->marks, pr->num, pr->op);
+    case F_NAME: return compare_values(strcmp(s->name, pr->str), 0, pr->op);
+    case F_SECTION: return compare_values(strcmp(s->section, pr->str), 0, pr->op);
+    default: return compare_values(strcmp(s->grade, pr->str), 0, pr->op);
+    }
+}
+
+// Whether s satisfies every predicate of q. Unlike run_query it keeps no
+// state, so scans on several threads can share one compiled query.
+int query_match(const Student *s, const Query *q)
+{
+    for (int k = 0; k < q->npreds; ++k)
+        if (!match_predicate(s, &q->preds[k])) return 0;
+    return 1;
+}
+
+static int cmp_text(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Writes a normalized form of q into out, for keying cached results:
+// predicates are sorted, so "a && b" and "b && a" share a key, and string
+// operands are length-prefixed so no operand can fake a separator.
+// Returns 0 if the key does not fit in size bytes.
+int query_key(const Query *q, char *out, int size)
+{
+    char preds[MAX_PREDICATES][80];
+    const char *order[MAX_PREDICATES];
+    for (int k = 0; k < q->npreds; ++k)
+    {
+        const Predicate *pr = &q->preds[k];
+        if (pr->field == F_ROLL || pr->field == F_MARKS)
+            snprintf(preds[k], sizeof(preds[k]), "%d%d#%.17g", pr->field, pr->op, pr->num);
+        else
+            snprintf(preds[k], sizeof(preds[k]), "%d%d$%d:%s", pr->field, pr->op, (int)strlen(pr->str), pr->str);
+        order[k] = preds[k];
+    }
+    qsort(order, q->npreds, sizeof(order[0]), cmp_text);
+    int len = snprintf(out, size, "query");
+    for (int k = 0; k < q->npreds && len < size; ++k) len += snprintf(out + len, size - len, " %s", order[k]);
+    if (len < size)
+        len += snprintf(out + len, size - len, " order %d%s limit %d", q->order_field, q->order_desc ? "d" : "a", q->limit);
+    return len < size;
+}
+
+// Lower runs first: roll equality, other numeric tests, then string tests.
+static int predicate_cost(const Predicate *pr)
+{
+    if (pr->field == F_ROLL && pr->op == OP_EQ) return 0;
+    if (pr->field == F_ROLL || pr->field == F_MARKS) return 1;
+    return 2;
+}
+
+static int compare_order(const Student *A, const Student *B, const Query *q)
+{
+    int c;
+    switch (q->order_field)
+    {
+    case F_ROLL: c = (A->roll > B->roll) - (A->roll < B->roll); break;
+    case F_MARKS: c = (A->marks > B->marks) - (A->marks < B->marks); break;
+    case F_NAME: c = strcmp(A->name, B->name); break;
+    case F_SECTION: c = strcmp(A->section, B->section); break;
+    default: c = strcmp(A->grade, B->grade); break;
+    }
+    return q->order_desc ? -c : c;
+}
+
+// Stable merge sort of a[0..n) by q's order, with tmp room for n / 2
+// records. Takes the ordering from q rather than from globals, so queries
+// on several threads can sort at once.
+static void sort_by_order(Student *a, Student *tmp, int n, const Query *q)
+{
+    if (n < 2) return;
+    int h = n / 2, i = 0, j = h, k = 0;
+    sort_by_order(a, tmp, h, q);
+    sort_by_order(a + h, tmp, n - h, q);
+    if (compare_order(&a[h-1], &a[h], q) <= 0) return;
+    memcpy(tmp, a, sizeof(Student) * h);
+    while (i < h && j < n) a[k++] = compare_order(&a[j], &tmp[i], q) < 0 ? a[j++] : tmp[i++];
+    while (i < h) a[k++] = tmp[i++];
+}
+
+// Runs q over arr[0..n) and compacts the result rows to the front of arr.
+// Returns the number of result rows. Keeps no state between calls, so it
+// may run on several threads at once.
+int run_query(Student arr[], int n, const Query *q)
+{
+    unsigned long long t0 = metrics_start();
+    int small_sel[MAX_STUDENTS];
+    int *sel = n <= MAX_STUDENTS ? small_sel : malloc(sizeof(int) * n); // results across terms can be larger
+    if (!sel) return 0;
+    Predicate preds[MAX_PREDICATES];
+    int np = q->npreds;
+    memcpy(preds, q->preds, sizeof(Predicate) * np);
+    for (int i = 1; i < np; ++i) // insertion sort by cost, stable
+        for (int j = i; j > 0 && predicate_cost(&preds[j]) < predicate_cost(&preds[j-1]); --j)
+        {
+            Predicate t = preds[j];
+            preds[j] = preds[j-1];
+            preds[j-1] = t;
+        }
+
+    int m = n;
+    for (int i = 0; i < n; ++i) sel[i] = i;
+    for (int k = 0; k < np && m > 0; ++k)
+    {
+        int kept = 0;
+        for (int i = 0; i < m; ++i)
+            if (match_predicate(&arr[sel[i]], &preds[k])) sel[kept++] = sel[i];
+        m = kept;
+    }
+    for (int i = 0; i < m; ++i) arr[i] = arr[sel[i]]; // sel is increasing, so in-place is safe
+
+    if (sel != small_sel) free(sel);
+    if (q->order_field != F_NONE && m > 1)
+    {
+        Student *tmp = malloc(sizeof(Student) * (m / 2));
+        if (!tmp) return 0;
+        sort_by_order(arr, tmp, m, q);
+        free(tmp);
+    }
+    if (q->limit > 0 && m > q->limit) m = q->limit;
+    metrics_end(M_QUERY, t0, 0);
+    return m;
+}
@@ -0,0 +1,451 @@
+// replica.c
+// Hot standby: a copy of the roster in another directory, kept current by
+// replaying the change stream (cdc.c).
+//
+// replica_sync runs from the primary's directory. The first call seeds the
+// copy from the primary as it stands; later calls read only the changes
+// since the sequence number recorded in <dir>/REPLICA_FILE_NAME, so a sync
+// costs the new changes and never reads the primary's roster. The stream
+// holds every committed change, and each event carries the position it
+// applies at, so replaying a batch reproduces the primary's file record for
+// record. The copy's lock file carries the generation of the last applied
+// batch, so the pager, roll index and GUI cache of a front end reading the
+// standby notice each one.
+//
+// The copy is reseeded from the primary's file only on a detected gap: the
+// stream ends before the recorded position or no longer has the recorded
+// generation there (it was replaced), an event does not fit the copy, or
+// the copy does not hash to what the position file says, as after a crash
+// between rewriting the copy and recording the position.
+//
+// The marker file makes lock_store refuse writes in the standby directory;
+// replica_promote removes it and the copy becomes a primary of its own.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "student_store.h"
+
+#define REPLICA_BATCH 1024
+#define REPLICA_MAX_PENDING (1 << 20) // changes applied per call, give or take a batch
+
+static void replica_path(const char *dir, const char *file, char *out, int size)
+{
+    snprintf(out, size, "%s/%s", dir, file);
+}
+
+// Wall-clock time in ns since the Unix epoch, comparable with file mtimes.
+static long long wall_ns(void)
+{
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    long long t = ((long long)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return (t - 116444736000000000LL) * 100;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+static long long mtime_ns(const struct stat *st)
+{
+#if defined(__linux__)
+    return (long long)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    return (long long)st->st_mtimespec.tv_sec * 1000000000LL + st->st_mtimespec.tv_nsec;
+#else
+    return (long long)st->st_mtime * 1000000000LL;
+#endif
+}
+
+/* ---------------- Position file ---------------- */
+
+// The position is "seq gen hash": the last change applied, its generation,
+// and copy_hash of the copy it produced.
+static int read_position(const char *dir, unsigned long long *seq, unsigned long long *gen, unsigned long long *hash)
+{
+    char path[512];
+    replica_path(dir, REPLICA_FILE_NAME, path, sizeof(path));
+    FILE *fp = fopen(path, "r");
+    if (!fp) return 0;
+    int ok = fscanf(fp, "%llu %llu %llu", seq, gen, hash) == 3;
+    fclose(fp);
+    return ok;
+}
+
+static int write_position(const char *dir, unsigned long long seq, unsigned long long gen, unsigned long long hash)
+{
+    char path[512], tmp[520];
+    replica_path(dir, REPLICA_FILE_NAME, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return 0;
+    fprintf(fp, "%llu %llu %llu\n", seq, gen, hash);
+    int ok = fclose(fp) == 0;
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tmp, path) == 0;
+#endif
+    return ok;
+}
+
+/* ---------------- The standby copy ---------------- */
+
+typedef struct
+{
+    Student *recs;
+    int n, cap;
+} Copy;
+
+static int copy_reserve(Copy *c, int more)
+{
+    if (c->n + more <= c->cap) return 1;
+    int cap = c->cap ? c->cap : 64;
+    while (cap < c->n + more) cap *= 2;
+    Student *grown = realloc(c->recs, sizeof(Student) * cap);
+    if (!grown) return 0;
+    c->recs = grown;
+    c->cap = cap;
+    return 1;
+}
+
+// FNV-1a over the copy's bytes, eight at a time.
+static unsigned long long copy_hash(const Copy *c)
+{
+    const unsigned char *p = (const unsigned char *)c->recs;
+    size_t len = (size_t)c->n * sizeof(Student), i = 0;
+    unsigned long long h = 14695981039346656037ULL;
+    for (; i + 8 <= len; i += 8)
+    {
+        unsigned long long w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * 1099511628211ULL;
+    }
+    for (; i < len; ++i) h = (h ^ p[i]) * 1099511628211ULL;
+    return h;
+}
+
+// Applies one batch of m changes, all from one write, in the order
+// cdc_begin lists them: deletes by descending position, inserts by
+// ascending position, then updates. Returns 1, 0 if the batch does not fit
+// the copy (it has drifted from the primary), or -1 if out of memory.
+static int copy_apply(Copy *c, const ChangeRecord *ev, int m)
+{
+    if (m == 1 && ev->op == CDC_INSERT && ev->pos == c->n) // an append
+    {
+        if (!copy_reserve(c, 1)) return -1;
+        c->recs[c->n++] = ev->rec;
+        return 1;
+    }
+
+    int k = 0, ndel = 0, nins = 0;
+    while (k + ndel < m && ev[k + ndel].op == CDC_DELETE) ++ndel;
+    while (k + ndel + nins < m && ev[k + ndel + nins].op == CDC_INSERT) ++nins;
+    Student *recs = c->recs;
+    int n = c->n - ndel + nins;
+    if (ndel + nins > 0)
+    {
+        // Rebuild in one pass: drop the deleted, merge in the inserted.
+        unsigned char *dead = calloc((size_t)c->n + 1, 1);
+        recs = malloc(sizeof(Student) * (n > 0 ? n : 1));
+        if (!dead || !recs)
+        {
+            free(dead);
+            free(recs);
+            return -1;
+        }
+        int ok = n >= 0;
+        for (int below = c->n; ok && k < ndel; ++k)
+        {
+            int i = ev[k].pos;
+            ok = i >= 0 && i < below && c->recs[i].roll == ev[k].rec.roll;
+            if (ok) dead[i] = 1, below = i;
+        }
+        for (int j = 0, src = 0; ok && j < n; ++j)
+        {
+            if (k < ndel + nins && ev[k].pos == j)
+            {
+                recs[j] = ev[k++].rec;
+                continue;
+            }
+            while (src < c->n && dead[src]) ++src;
+            ok = src < c->n;
+            if (ok) recs[j] = c->recs[src++];
+        }
+        free(dead);
+        if (!ok || k != ndel + nins)
+        {
+            free(recs);
+            return 0;
+        }
+    }
+    for (; k < m && ev[k].op == CDC_UPDATE; ++k)
+    {
+        int i = ev[k].pos;
+        if (i < 0 || i >= n || recs[i].roll != ev[k].rec.roll) break;
+        recs[i] = ev[k].rec;
+    }
+    if (recs != c->recs)
+    {
+        if (k != m)
+        {
+            free(recs);
+            return 0;
+        }
+        free(c->recs);
+        c->recs = recs;
+        c->n = c->cap = n;
+    }
+    return k == m;
+}
+
+static void copy_free(Copy *c)
+{
+    free(c->recs);
+}
+
+static int read_copy(const char *dir, Copy *c)
+{
+    char path[512];
+    replica_path(dir, FILE_NAME, path, sizeof(path));
+    memset(c, 0, sizeof(*c));
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 1; // an empty roster has no file
+    struct stat st;
+    int ok = fstat(fileno(fp), &st) == 0;
+    int want = ok ? (int)(st.st_size / sizeof(Student)) : 0;
+    ok = ok && copy_reserve(c, want);
+    if (ok) c->n = (int)fread(c->recs, sizeof(Student), want, fp);
+    fclose(fp);
+    return ok;
+}
+
+// Replaces the copy and stamps its lock file with the primary generation.
+static int write_copy(const char *dir, const Copy *c, unsigned long long gen)
+{
+    char path[512], tmp[520];
+    replica_path(dir, FILE_NAME, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    replica_path(dir, LOCK_FILE_NAME, path, sizeof(path));
+    int lk = lock_store_file(path, 1);
+    if (lk < 0) return 0;
+    replica_path(dir, FILE_NAME, path, sizeof(path));
+    FILE *fp = fopen(tmp, "wb");
+    int ok = fp && fwrite(c->recs, sizeof(Student), c->n, fp) == (size_t)c->n;
+    ok = ok && fflush(fp) == 0;
+#ifndef _WIN32
+    ok = ok && fsync(fileno(fp)) == 0;
+#endif
+    if (fp) ok = fclose(fp) == 0 && ok;
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tmp, path) == 0;
+#endif
+    if (!ok) remove(tmp);
+    ok = ok && lseek(lk, 0, SEEK_SET) == 0 && write(lk, &gen, sizeof(gen)) == (int)sizeof(gen);
+    unlock_store(lk);
+    return ok;
+}
+
+/* ---------------- Sync and promotion ---------------- */
+
+// Generation of change seq, or 0 if there is no such change.
+static unsigned long long change_generation(unsigned long long seq)
+{
+    ChangeRecord ch;
+    return seq > 0 && cdc_read(seq, &ch, 1) == 1 ? ch.generation : 0;
+}
+
+// Replaces the copy with the primary's records and the newest change they
+// include, read under one shared lock.
+static int copy_primary(Copy *c, unsigned long long *seq, unsigned long long *gen)
+{
+    int lk = lock_store(0);
+    if (lk < 0) return 0;
+    int n;
+    Student *recs = load_all_students_locked(&n);
+    unsigned long long last = cdc_last_seq_locked(lk);
+    unlock_store(lk);
+    if (!recs && n > 0) return 0;
+    copy_free(c);
+    c->recs = recs;
+    c->n = c->cap = recs ? n : 0;
+    // Committed changes stay put, so this agrees with what the lock saw.
+    *seq = last;
+    *gen = change_generation(last);
+    return 1;
+}
+
+static int write_replica(const char *dir, const Copy *c, unsigned long long seq, unsigned long long gen)
+{
+    return write_copy(dir, c, gen) && write_position(dir, seq, gen, copy_hash(c));
+}
+
+// Seeds dir from the primary. Refuses a directory that already holds a
+// roster without a position file: that is a promoted standby or a primary.
+static int seed(const char *dir, unsigned long long *seq, unsigned long long *gen, unsigned long long *hash)
+{
+    char path[512];
+    struct stat st;
+    replica_path(dir, FILE_NAME, path, sizeof(path));
+    if (stat(path, &st) == 0)
+    {
+        fprintf(stderr, "Error: %s already holds a roster that is not a replica\n", dir);
+        return 0;
+    }
+#ifdef _WIN32
+    _mkdir(dir);
+#else
+    mkdir(dir, 0755);
+#endif
+    Copy c;
+    memset(&c, 0, sizeof(c));
+    int ok = copy_primary(&c, seq, gen) && write_replica(dir, &c, *seq, *gen);
+    *hash = copy_hash(&c);
+    copy_free(&c);
+    if (!ok) fprintf(stderr, "Error: cannot write the replica in %s\n", dir);
+    return ok;
+}
+
+// Applies the changes after *seq up to last, a write's batch at a time, and
+// stops early once about REPLICA_MAX_PENDING are in. Returns 1, 0 on a
+// gap, or -1 on an error.
+static int apply_changes(Copy *c, unsigned long long *seq, unsigned long long *gen, unsigned long long last,
+                         ReplicaStatus *st)
+{
+    ChangeRecord *buf = NULL;
+    size_t n = 0, cap = 0;
+    unsigned long long next = *seq + 1;
+    int rc = 1;
+    while (rc == 1 && next <= last && st->applied < REPLICA_MAX_PENDING)
+    {
+        if (n + REPLICA_BATCH > cap)
+        {
+            size_t grown = (n + REPLICA_BATCH) * 2;
+            ChangeRecord *more = realloc(buf, grown * sizeof(ChangeRecord));
+            if (!more)
+            {
+                rc = -1;
+                break;
+            }
+            buf = more;
+            cap = grown;
+        }
+        int want = last - next + 1 < REPLICA_BATCH ? (int)(last - next + 1) : REPLICA_BATCH;
+        int got = cdc_read(next, buf + n, want);
+        if (got == 0)
+        {
+            rc = 0; // committed changes went missing: the stream was replaced
+            break;
+        }
+        next += got;
+        n += got;
+
+        // A write's batch is complete once the next generation starts.
+        size_t start = 0;
+        for (size_t k = 1; rc == 1 && k <= n; ++k)
+        {
+            if (k < n ? buf[k].generation == buf[start].generation : next <= last) continue;
+            if (buf[start].generation <= *gen) rc = 0;
+            else rc = copy_apply(c, buf + start, (int)(k - start));
+            if (rc != 1) break;
+            *seq = buf[k - 1].seq;
+            *gen = buf[start].generation;
+            st->applied += (int)(k - start);
+            start = k;
+        }
+        memmove(buf, buf + start, (n - start) * sizeof(ChangeRecord));
+        n -= start;
+    }
+    free(buf);
+    return rc;
+}
+
+// Brings the standby in dir up to date with the primary in the current
+// directory, seeding it on first use. Returns STORE_OK or STORE_ERROR; st,
+// if given, receives the position and lag.
+int replica_sync(const char *dir, ReplicaStatus *st)
+{
+    ReplicaStatus local;
+    if (!st) st = &local;
+    memset(st, 0, sizeof(*st));
+    st->lag_seconds = -1;
+
+    unsigned long long seq, gen, hash;
+    if (!read_position(dir, &seq, &gen, &hash) && !seed(dir, &seq, &gen, &hash)) return STORE_ERROR;
+
+    // The stream's mtime is the commit time of its newest change.
+    struct stat cs;
+    long long committed = stat(CDC_FILE_NAME, &cs) == 0 ? mtime_ns(&cs) : 0;
+    unsigned long long last = cdc_last_seq();
+    st->primary_seq = last;
+
+    Copy c;
+    memset(&c, 0, sizeof(c));
+    int ok = 1;
+    if (last != seq)
+    {
+        int rc;
+        if (last < seq || change_generation(seq) != gen) rc = 0; // the stream was replaced
+        else if (!read_copy(dir, &c)) rc = -1;
+        else if (copy_hash(&c) != hash) rc = 0; // a sync died before recording its position
+        else rc = apply_changes(&c, &seq, &gen, last, st);
+        if (rc == 0)
+        {
+            rc = copy_primary(&c, &seq, &gen) ? 1 : -1;
+            st->reseeded = rc == 1;
+            st->primary_seq = seq > last ? seq : last;
+        }
+        ok = rc == 1 && ((!st->applied && !st->reseeded) || write_replica(dir, &c, seq, gen));
+    }
+    else
+    {
+        // Caught up: the copy is what the position file says it is.
+        struct stat fs;
+        char path[512];
+        replica_path(dir, FILE_NAME, path, sizeof(path));
+        c.n = stat(path, &fs) == 0 ? (int)(fs.st_size / sizeof(Student)) : 0;
+    }
+    if (ok && st->applied > 0 && seq == st->primary_seq && committed)
+    {
+        long long lag = wall_ns() - committed;
+        if (lag < 0) lag = 0;
+        st->lag_seconds = lag / 1e9;
+        metrics_record(M_REPLICA_LAG, (unsigned long long)lag, (unsigned long long)st->applied * sizeof(ChangeRecord));
+    }
+    st->applied_seq = seq;
+    st->generation = gen;
+    st->records = c.n;
+    copy_free(&c);
+    if (!ok) fprintf(stderr, "Error: cannot update the replica in %s\n", dir);
+    return ok ? STORE_OK : STORE_ERROR;
+}
+
+// Turns the standby in dir into a writable primary. Its change stream
+// starts afresh; the generation carries on from the old primary's.
+int replica_promote(const char *dir)
+{
+    char path[512];
+    replica_path(dir, LOCK_FILE_NAME, path, sizeof(path));
+    int lk = lock_store_file(path, 1);
+    if (lk < 0) return STORE_ERROR;
+    replica_path(dir, REPLICA_FILE_NAME, path, sizeof(path));
+    int ok = remove(path) == 0;
+    unlock_store(lk);
+    if (!ok) fprintf(stderr, "Error: %s is not a replica\n", dir);
+    return ok ? STORE_OK : STORE_ERROR;
+}
@@ -0,0 +1,105 @@
+// rollmap.c
+// Roll number -> array index map, for code that looks rolls up by the
+// thousand (transactions, the duplicate check in insert_student) and
+// cannot afford a linear find_by_roll each. Open addressing with
+// tombstones; doubles when half full.
+
+#include <limits.h>
+#include <stdlib.h>
+
+#include "student_store.h"
+
+#define SLOT_EMPTY LLONG_MIN
+#define SLOT_GONE (LLONG_MIN + 1)
+
+static size_t slot_of(const RollMap *m, int roll)
+{
+    unsigned long long h = (unsigned long long)(unsigned int)roll * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h >> 17) & (m->slots - 1);
+}
+
+// Sizes the map for about capacity rolls. Returns 0 when out of memory.
+int rollmap_init(RollMap *m, size_t capacity)
+{
+    size_t want = 16;
+    while (want < 2 * capacity) want *= 2;
+    m->keys = malloc(want * sizeof(long long));
+    m->vals = malloc(want * sizeof(int));
+    m->slots = want;
+    m->used = 0;
+    if (!m->keys || !m->vals)
+    {
+        rollmap_free(m);
+        return 0;
+    }
+    for (size_t i = 0; i < want; ++i) m->keys[i] = SLOT_EMPTY;
+    return 1;
+}
+
+void rollmap_free(RollMap *m)
+{
+    free(m->keys);
+    free(m->vals);
+    m->keys = NULL;
+    m->vals = NULL;
+    m->slots = m->used = 0;
+}
+
+// Index stored for roll, or -1.
+int rollmap_find(const RollMap *m, int roll)
+{
+    for (size_t i = slot_of(m, roll);; i = (i + 1) & (m->slots - 1))
+    {
+        if (m->keys[i] == SLOT_EMPTY) return -1;
+        if (m->keys[i] == roll) return m->vals[i];
+    }
+}
+
+static int grow(RollMap *m)
+{
+    RollMap bigger;
+    if (!rollmap_init(&bigger, m->slots)) return 0;
+    for (size_t i = 0; i < m->slots; ++i)
+        if (m->keys[i] != SLOT_EMPTY && m->keys[i] != SLOT_GONE) rollmap_put(&bigger, (int)m->keys[i], m->vals[i]);
+    rollmap_free(m);
+    *m = bigger;
+    return 1;
+}
+
+// Maps roll to idx, replacing any previous index. Returns 0 when out of
+// memory.
+int rollmap_put(RollMap *m, int roll, int idx)
+{
+    if (2 * (m->used + 1) > m->slots && !grow(m)) return 0;
+    size_t gone = (size_t)-1;
+    for (size_t i = slot_of(m, roll);; i = (i + 1) & (m->slots - 1))
+    {
+        if (m->keys[i] == roll)
+        {
+            m->vals[i] = idx;
+            return 1;
+        }
+        if (m->keys[i] == SLOT_GONE && gone == (size_t)-1) gone = i;
+        if (m->keys[i] == SLOT_EMPTY)
+        {
+            if (gone != (size_t)-1) i = gone;
+            else m->used++;
+            m->keys[i] = roll;
+            m->vals[i] = idx;
+            return 1;
+        }
+    }
+}
+
+void rollmap_remove(RollMap *m, int roll)
+{
+    for (size_t i = slot_of(m, roll);; i = (i + 1) & (m->slots - 1))
+    {
+        if (m->keys[i] == SLOT_EMPTY) return;
+        if (m->keys[i] == roll)
+        {
+            m->keys[i] = SLOT_GONE; // still counted in used until the next grow
+            return;
+        }
+    }
+}
@@ -0,0 +1,206 @@
+// snapshot.c
+// Named point-in-time snapshots of the roster.
+//
+// A snapshot is SNAPSHOT_DIR/<name>.snap plus a line in SNAPSHOT_CATALOG
+// with the time it was taken, the store generation and the record count.
+// The file is a hard link to FILE_NAME made under the exclusive lock, so
+// taking a snapshot copies nothing and costs the same whatever the size
+// of the roster. The link keeps its contents because FILE_NAME is never
+// rewritten in place: save_all_students renames a new file over it, and
+// an append first gives FILE_NAME a copy of its own while a snapshot still
+// shares it (see append_locked). A snapshot is read-only; queries "as of"
+// a time use the newest snapshot taken at or before it. Where hard links
+// are not available (Windows, some network shares) the file is copied.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "student_store.h"
+
+static int valid_snapshot_name(const char *name)
+{
+    int len = (int)strlen(name);
+    if (len == 0 || len >= SNAPSHOT_NAME_LEN) return 0;
+    for (int i = 0; i < len; ++i)
+        if (!isalnum((unsigned char)name[i]) && !strchr("-_.", name[i])) return 0;
+    return name[0] != '.';
+}
+
+void snapshot_path(const char *name, char *out, int size)
+{
+    snprintf(out, size, "%s/%.*s.snap", SNAPSHOT_DIR, SNAPSHOT_NAME_LEN - 1, name);
+}
+
+/* ---------------- Catalog ---------------- */
+
+// Caller holds the store lock.
+static int read_snapshots(Snapshot out[], int max)
+{
+    FILE *fp = fopen(SNAPSHOT_CATALOG, "r");
+    if (!fp) return 0;
+    int n = 0;
+    char line[256];
+    while (n < max && fgets(line, sizeof(line), fp))
+    {
+        Snapshot *s = &out[n];
+        if (sscanf(line, "%31s %lld %llu %d", s->name, &s->taken, &s->generation, &s->records) == 4) n++;
+    }
+    fclose(fp);
+    return n;
+}
+
+// Oldest first.
+int snapshot_list(Snapshot out[], int max)
+{
+    int lk = lock_store(0);
+    int n = read_snapshots(out, max);
+    unlock_store(lk);
+    return n;
+}
+
+// The newest snapshot taken at or before when. Returns 0 if there is none.
+int snapshot_as_of(long long when, Snapshot *out)
+{
+    static Snapshot all[MAX_SNAPSHOTS];
+    int n = snapshot_list(all, MAX_SNAPSHOTS), found = 0;
+    for (int i = 0; i < n; ++i)
+        if (all[i].taken <= when && (!found || all[i].taken >= out->taken))
+        {
+            *out = all[i];
+            found = 1;
+        }
+    return found;
+}
+
+/* ---------------- Taking and reading ---------------- */
+
+// Snapshots the roster as name, or as the local time (YYYYMMDD-HHMMSS)
+// when name is NULL or empty, and describes it in out if not NULL.
+// Returns STORE_OK, STORE_DUPLICATE (name taken) or STORE_ERROR.
+int snapshot_create(const char *name, Snapshot *out)
+{
+    static Snapshot all[MAX_SNAPSHOTS];
+    Snapshot snap = {0};
+    time_t now = time(NULL);
+    snap.taken = (long long)now;
+    if (name && *name) snprintf(snap.name, sizeof(snap.name), "%s", name);
+    else strftime(snap.name, sizeof(snap.name), "%Y%m%d-%H%M%S", localtime(&now));
+    if (name && *name && !valid_snapshot_name(name))
+    {
+        fprintf(stderr, "Error: snapshot names use letters, digits, '-', '_' and '.'\n");
+        return STORE_ERROR;
+    }
+    char path[64];
+    snapshot_path(snap.name, path, sizeof(path));
+
+    int lk = lock_store(1);
+    if (lk < 0) return STORE_ERROR;
+    int n = read_snapshots(all, MAX_SNAPSHOTS), r = STORE_OK;
+    for (int i = 0; i < n; ++i)
+        if (strcmp(all[i].name, snap.name) == 0) r = STORE_DUPLICATE;
+    if (r == STORE_OK && n == MAX_SNAPSHOTS) r = STORE_ERROR;
+    if (r == STORE_OK)
+    {
+        struct stat st;
+        snap.generation = store_generation_locked(lk);
+        snap.records = stat(FILE_NAME, &st) == 0 ? (int)(st.st_size / sizeof(Student)) : 0;
+#ifdef _WIN32
+        _mkdir(SNAPSHOT_DIR);
+#else
+        mkdir(SNAPSHOT_DIR, 0755);
+#endif
+        remove(path); // left over from a snapshot that never reached the catalog
+        int ok;
+        if (snap.records == 0)
+        {
+            FILE *fp = fopen(path, "wb");
+            ok = fp && fclose(fp) == 0;
+        }
+#ifdef _WIN32
+        else ok = copy_file(FILE_NAME, path);
+#else
+        else ok = link(FILE_NAME, path) == 0 || copy_file(FILE_NAME, path);
+#endif
+        FILE *cat = ok ? fopen(SNAPSHOT_CATALOG, "a") : NULL;
+        if (cat)
+        {
+            fprintf(cat, "%s %lld %llu %d\n", snap.name, snap.taken, snap.generation, snap.records);
+            ok = fclose(cat) == 0;
+        }
+        if (!cat || !ok)
+        {
+            remove(path);
+            r = STORE_ERROR;
+        }
+    }
+    unlock_store(lk);
+    if (r == STORE_OK && out) *out = snap;
+    return r;
+}
+
+// Every record of snapshot name, in a malloc'd array the caller frees.
+// Returns NULL (and *n = 0) if the snapshot is empty or missing. Needs no
+// lock: a snapshot never changes.
+Student *snapshot_load(const char *name, int *n)
+{
+    char path[64];
+    struct stat st;
+    *n = 0;
+    snapshot_path(name, path, sizeof(path));
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+    Student *arr = NULL;
+    if (fstat(fileno(fp), &st) == 0 && st.st_size >= (long long)sizeof(Student))
+    {
+        size_t want = (size_t)st.st_size / sizeof(Student);
+        arr = malloc(want * sizeof(Student));
+        if (arr) *n = (int)fread(arr, sizeof(Student), want, fp);
+    }
+    fclose(fp);
+    return arr;
+}
+
+// Forgets snapshot name and deletes its file. Returns STORE_OK or
+// STORE_ERROR (no such snapshot).
+int snapshot_drop(const char *name)
+{
+    static Snapshot all[MAX_SNAPSHOTS];
+    char path[64], tmp[64];
+    int lk = lock_store(1);
+    if (lk < 0) return STORE_ERROR;
+    int n = read_snapshots(all, MAX_SNAPSHOTS), m = 0;
+    for (int i = 0; i < n; ++i)
+        if (strcmp(all[i].name, name) != 0) all[m++] = all[i];
+    int ok = m < n;
+    snprintf(tmp, sizeof(tmp), "%s.tmp", SNAPSHOT_CATALOG);
+    FILE *fp = ok ? fopen(tmp, "w") : NULL;
+    if (fp)
+    {
+        for (int i = 0; i < m; ++i)
+            fprintf(fp, "%s %lld %llu %d\n", all[i].name, all[i].taken, all[i].generation, all[i].records);
+        ok = fclose(fp) == 0;
+#ifdef _WIN32
+        ok = ok && MoveFileExA(tmp, SNAPSHOT_CATALOG, MOVEFILE_REPLACE_EXISTING);
+#else
+        ok = ok && rename(tmp, SNAPSHOT_CATALOG) == 0;
+#endif
+    }
+    else ok = 0;
+    if (ok)
+    {
+        snapshot_path(name, path, sizeof(path));
+        remove(path);
+    }
+    unlock_store(lk);
+    return ok ? STORE_OK : STORE_ERROR;
+}
@@ -0,0 +1,376 @@
+// stats.c
+// Order statistics over marks and per-section aggregates.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "student_store.h"
+
+/* ---------------- Order statistics ----------------
+ * Marks are bounded to 0..100, so a histogram with one bucket per 0.01 mark
+ * answers rank, median and percentile queries exactly at display precision.
+ * hist_prepare rebuilds the prefix sums (10001 steps) only when something
+ * changed since, after which a rank is O(1) and a percentile a binary search
+ * over the buckets. The rank index below keeps one histogram current across
+ * changes with hist_add/hist_remove instead of rebuilding it per query.
+ */
+
+// Clamped before the cast, with a test NaN fails, so NaN lands in bucket 0.
+int hist_bucket(float marks)
+{
+    float b = marks * 100 + 0.5f;
+    return !(b > 0) ? 0 : b >= HIST_BUCKETS ? HIST_BUCKETS - 1 : (int)b;
+}
+
+void hist_add(MarksHistogram *h, float marks)
+{
+    h->count[hist_bucket(marks)]++;
+    h->n++;
+    h->sum += marks;
+    h->sumsq += (double)marks * marks;
+    h->dirty = 1;
+}
+
+void hist_remove(MarksHistogram *h, float marks)
+{
+    h->count[hist_bucket(marks)]--;
+    h->n--;
+    h->sum -= marks;
+    h->sumsq -= (double)marks * marks;
+    h->dirty = 1;
+}
+
+void hist_build(MarksHistogram *h, const Student arr[], int n)
+{
+    memset(h, 0, sizeof(*h));
+    for (int i = 0; i < n; ++i) hist_add(h, arr[i].marks);
+}
+
+static void hist_prepare(MarksHistogram *h)
+{
+    if (!h->dirty) return;
+    h->cum[0] = 0;
+    for (int b = 0; b < HIST_BUCKETS; ++b) h->cum[b+1] = h->cum[b] + h->count[b];
+    h->dirty = 0;
+}
+
+// k-th smallest mark, 0-based.
+float hist_kth(MarksHistogram *h, int k)
+{
+    hist_prepare(h);
+    int lo = 0, hi = HIST_BUCKETS - 1; // first bucket with cum[b+1] > k
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (h->cum[mid+1] > k) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo / 100.0f;
+}
+
+float hist_median(MarksHistogram *h)
+{
+    if (h->n % 2) return hist_kth(h, h->n / 2);
+    return (hist_kth(h, h->n / 2 - 1) + hist_kth(h, h->n / 2)) / 2;
+}
+
+// Nearest-rank percentile, p in 0..100.
+float hist_percentile(MarksHistogram *h, float p)
+{
+    int k = (int)ceil(p / 100 * h->n) - 1;
+    if (k < 0) k = 0;
+    if (k >= h->n) k = h->n - 1;
+    return hist_kth(h, k);
+}
+
+// 1 for the highest marks; equal marks share a rank.
+int hist_rank(MarksHistogram *h, float marks)
+{
+    hist_prepare(h);
+    return 1 + h->n - h->cum[hist_bucket(marks) + 1];
+}
+
+double hist_stddev(const MarksHistogram *h)
+{
+    double mean = h->sum / h->n;
+    double var = h->sumsq / h->n - mean * mean;
+    return var > 0 ? sqrt(var) : 0;
+}
+
+/* ---------------- Rank index ----------------
+ * Answers "where does roll R rank" without reloading the roster: a copy of
+ * the records, the index of each roll's first record, a histogram of the
+ * marks and a Fenwick tree over its buckets, so a lookup is one hash probe
+ * plus O(log buckets). Our own appends and saves update it in place
+ * (store_io.c calls rank_note_append and rank_note_save under the exclusive
+ * lock); when the generation shows another process wrote, the next lookup
+ * rebuilds it from the file. Only touched with the store lock held.
+ */
+
+static struct
+{
+    Student *recs;
+    int n, cap;
+    RollMap first;               // roll -> index of its first record
+    MarksHistogram hist;
+    int tree[HIST_BUCKETS + 1];  // Fenwick tree over hist.count, 1-based
+    unsigned long long generation;
+    int valid;
+} ranks;
+
+static void tree_add(int bucket, int delta)
+{
+    for (int i = bucket + 1; i <= HIST_BUCKETS; i += i & -i) ranks.tree[i] += delta;
+}
+
+// Marks in buckets 0..bucket.
+static int tree_prefix(int bucket)
+{
+    int sum = 0;
+    for (int i = bucket + 1; i > 0; i -= i & -i) sum += ranks.tree[i];
+    return sum;
+}
+
+static void rank_add(float marks)
+{
+    hist_add(&ranks.hist, marks);
+    tree_add(hist_bucket(marks), 1);
+}
+
+static void rank_remove(float marks)
+{
+    hist_remove(&ranks.hist, marks);
+    tree_add(hist_bucket(marks), -1);
+}
+
+static int ranks_reserve(int n)
+{
+    if (ranks.cap >= n) return 1;
+    int cap = ranks.cap ? ranks.cap : 256;
+    while (cap < n) cap *= 2;
+    Student *p = realloc(ranks.recs, sizeof(Student) * cap);
+    if (!p) return 0;
+    ranks.recs = p;
+    ranks.cap = cap;
+    return 1;
+}
+
+static int ranks_index_rolls(void)
+{
+    rollmap_free(&ranks.first);
+    if (!rollmap_init(&ranks.first, (size_t)ranks.n)) return 0;
+    for (int i = 0; i < ranks.n; ++i)
+        if (rollmap_find(&ranks.first, ranks.recs[i].roll) < 0 && !rollmap_put(&ranks.first, ranks.recs[i].roll, i))
+            return 0;
+    return 1;
+}
+
+// Indexes ranks.recs[0..n) from scratch.
+static int ranks_rebuild(unsigned long long generation)
+{
+    hist_build(&ranks.hist, ranks.recs, ranks.n);
+    ranks.tree[0] = 0;
+    for (int i = 1; i <= HIST_BUCKETS; ++i) ranks.tree[i] = ranks.hist.count[i-1];
+    for (int i = 1; i <= HIST_BUCKETS; ++i) // O(buckets) Fenwick build
+    {
+        int up = i + (i & -i);
+        if (up <= HIST_BUCKETS) ranks.tree[up] += ranks.tree[i];
+    }
+    ranks.generation = generation;
+    ranks.valid = ranks_index_rolls();
+    return ranks.valid;
+}
+
+// Reloads the index from FILE_NAME unless it already matches. Caller holds lk.
+static int ranks_sync(int lk)
+{
+    unsigned long long gen = store_generation_locked(lk);
+    if (ranks.valid && ranks.generation == gen) return 1;
+    ranks.valid = 0;
+    ranks.n = 0;
+    FILE *fp = fopen(FILE_NAME, "rb");
+    if (fp)
+    {
+        struct stat st;
+        int want = fstat(fileno(fp), &st) == 0 ? (int)(st.st_size / sizeof(Student)) : 0;
+        if (ranks_reserve(want)) ranks.n = (int)fread(ranks.recs, sizeof(Student), want, fp);
+        else want = -1;
+        fclose(fp);
+        if (want < 0) return 0;
+    }
+    return ranks_rebuild(gen);
+}
+
+// Records an append that moved the file from generation gen - 1 to gen.
+void rank_note_append(const Student *s, unsigned long long gen)
+{
+    if (!ranks.valid || !gen || ranks.generation != gen - 1 || !ranks_reserve(ranks.n + 1))
+    {
+        ranks.valid = 0;
+        return;
+    }
+    ranks.recs[ranks.n] = *s;
+    if (rollmap_find(&ranks.first, s->roll) < 0 && !rollmap_put(&ranks.first, s->roll, ranks.n))
+    {
+        ranks.valid = 0;
+        return;
+    }
+    ranks.n++;
+    rank_add(s->marks);
+    ranks.generation = gen;
+}
+
+// Records a save that replaced old[0..nold) with cur[0..ncur) and moved the
+// file to generation gen. Only the records between the common prefix and
+// suffix touch the histogram, so an update or a delete costs a few bucket
+// changes; the roll index is rebuilt only when positions moved.
+void rank_note_save(const Student old[], int nold, const Student cur[], int ncur, unsigned long long gen)
+{
+    if (!ranks.valid || !gen || ranks.generation != gen - 1 || nold != ranks.n || !ranks_reserve(ncur))
+    {
+        ranks.valid = 0;
+        return;
+    }
+    int pre = 0, suf = 0;
+    while (pre < nold && pre < ncur && memcmp(&old[pre], &cur[pre], sizeof(Student)) == 0) pre++;
+    while (suf < nold - pre && suf < ncur - pre &&
+           memcmp(&old[nold - 1 - suf], &cur[ncur - 1 - suf], sizeof(Student)) == 0) suf++;
+    int moved = nold != ncur;
+    for (int i = pre; i < nold - suf; ++i) rank_remove(old[i].marks);
+    for (int i = pre; i < ncur - suf; ++i)
+    {
+        rank_add(cur[i].marks);
+        moved = moved || cur[i].roll != old[i].roll;
+    }
+    memcpy(ranks.recs + pre, cur + pre, sizeof(Student) * (ncur - pre));
+    ranks.n = ncur;
+    ranks.generation = gen;
+    if (moved) ranks.valid = ranks_index_rolls();
+}
+
+// Rank of the first record with this roll: 1 for the highest marks, equal
+// marks sharing a rank. Returns 1 and fills out if found, 0 if not, -1 if
+// the store could not be read.
+int rank_of_roll(int roll, RankInfo *out)
+{
+    unsigned long long t0 = metrics_start();
+    int lk = lock_store(0);
+    if (lk < 0) return -1;
+    if (!ranks_sync(lk))
+    {
+        unlock_store(lk);
+        return -1;
+    }
+    int i = rollmap_find(&ranks.first, roll);
+    if (i >= 0)
+    {
+        int b = hist_bucket(ranks.recs[i].marks), upto = tree_prefix(b);
+        out->rec = ranks.recs[i];
+        out->n = ranks.n;
+        out->rank = 1 + ranks.n - upto;
+        out->below = upto - ranks.hist.count[b];
+    }
+    unlock_store(lk);
+    metrics_end(M_RANK, t0, 0);
+    return i >= 0;
+}
+
+/* Per-section aggregates, built by a single hash-aggregate pass */
+#define SECTION_SLOTS (2 * MAX_SECTIONS) // power of two
+#define OTHER_SECTION "(other)"
+
+static unsigned int hash_section(const char *s)
+{
+    unsigned int h = 2166136261u; // FNV-1a
+    for (int i = 0; i < 10 && s[i]; ++i) h = (h ^ (unsigned char)s[i]) * 16777619u;
+    return h;
+}
+
+static int cmp_section_name(const void *a, const void *b)
+{
+    return strncmp(((const SectionStats*)a)->section, ((const SectionStats*)b)->section, 10);
+}
+
+static unsigned int find_section_slot(const short slots[], const SectionStats out[], const char *key)
+{
+    unsigned int h = hash_section(key) & (SECTION_SLOTS - 1);
+    while (slots[h] && strncmp(out[slots[h]-1].section, key, 10) != 0)
+        h = (h + 1) & (SECTION_SLOTS - 1);
+    return h;
+}
+
+// Groups arr[0..n) by section into out (room for MAX_SECTIONS groups),
+// sorted by section. Sections beyond the first MAX_SECTIONS - 1 are pooled
+// in an "(other)" group. Returns the number of groups. Reentrant: the GUI
+// runs it on several worker threads at once.
+int group_by_section(const Student arr[], int n, SectionStats out[])
+{
+    short slots[SECTION_SLOTS] = {0}; // group index + 1, 0 = empty
+    int ng = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        const char *key = arr[i].section;
+        unsigned int h = find_section_slot(slots, out, key);
+        if (!slots[h] && ng == MAX_SECTIONS - 1 && strcmp(key, OTHER_SECTION) != 0)
+        {
+            key = OTHER_SECTION;
+            h = find_section_slot(slots, out, key);
+        }
+        SectionStats *g;
+        float m = arr[i].marks;
+        if (!slots[h])
+        {
+            g = &out[ng];
+            memset(g, 0, sizeof(*g));
+            strncpy(g->section, key, sizeof(g->section) - 1);
+            g->min = g->max = m;
+            slots[h] = (short)++ng;
+        }
+        else g = &out[slots[h]-1];
+        g->count++;
+        g->total += m;
+        if (m < g->min) g->min = m;
+        if (m > g->max) g->max = m;
+        g->grade_counts[grade_code(arr[i].grade)]++;
+    }
+    qsort(out, ng, sizeof(SectionStats), cmp_section_name);
+    return ng;
+}
+
+/* ---------------- Statistics report ---------------- */
+
+// Everything the Statistics screens show, computed in one pass plus the
+// histogram. Returns the bytes of *r in use (the groups past r->ngroups
+// are left untouched), which is what the result cache stores.
+size_t stats_report(const Student arr[], int n, StatsReport *r)
+{
+    memset(r, 0, offsetof(StatsReport, groups));
+    r->n = n;
+    if (n > 0) r->max = r->min = arr[0].marks;
+    for (int i = 0; i < n; ++i)
+    {
+        float m = arr[i].marks;
+        r->total += m;
+        if (m > r->max) r->max = m;
+        if (m < r->min) r->min = m;
+        r->grade_counts[grade_code(arr[i].grade)]++;
+    }
+    MarksHistogram *h = malloc(sizeof(MarksHistogram));
+    if (h)
+    {
+        hist_build(h, arr, n);
+        r->median = hist_median(h);
+        r->stddev = hist_stddev(h);
+        r->p10 = hist_percentile(h, 10);
+        r->p25 = hist_percentile(h, 25);
+        r->p75 = hist_percentile(h, 75);
+        r->p90 = hist_percentile(h, 90);
+        free(h);
+    }
+    r->ngroups = group_by_section(arr, n, r->groups);
+    return offsetof(StatsReport, groups) + sizeof(SectionStats) * r->ngroups;
+}
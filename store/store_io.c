@@ -0,0 +1,550 @@
+// store_io.c
+// Locked, atomic access to FILE_NAME shared by every front end.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#define ftruncate _chsize
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "student_store.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/* ---------------- Locking ----------------
+ * Every read takes a shared lock and every write an exclusive lock on
+ * LOCK_FILE_NAME, so the GUI and terminal programs can run side by side.
+ * The lock file also stores a generation counter that each write bumps:
+ * a rewrite is refused if the file changed since this process loaded it,
+ * and a cached copy is stale whenever store_generation() moves on.
+ *
+ * fcntl locks belong to the process, so they do not keep two threads of
+ * one program apart (the GUI saves on a worker thread); an in-process mutex
+ * is taken first for that. It is held for as long as the file lock, since
+ * the file lock alone would let a second thread in, and it blocks rather
+ * than spins: a thread waiting out another's fsync sleeps.
+ *
+ * A hot-standby copy (see replica.c) is marked by REPLICA_FILE_NAME and
+ * refuses exclusive locks, so every write fails there until it is promoted.
+ */
+
+#ifdef _WIN32
+static SRWLOCK thread_lock = SRWLOCK_INIT;
+#define thread_lock_take() AcquireSRWLockExclusive(&thread_lock)
+#define thread_lock_drop() ReleaseSRWLockExclusive(&thread_lock)
+#else
+static pthread_mutex_t thread_lock = PTHREAD_MUTEX_INITIALIZER;
+#define thread_lock_take() pthread_mutex_lock(&thread_lock)
+#define thread_lock_drop() pthread_mutex_unlock(&thread_lock)
+#endif
+
+_Thread_local unsigned long long loaded_generation = 0;
+
+int lock_store(int exclusive)
+{
+    struct stat st;
+    if (exclusive && stat(REPLICA_FILE_NAME, &st) == 0)
+    {
+        fprintf(stderr, "Error: %s is a read-only replica\n", FILE_NAME);
+        return -1;
+    }
+    int fd = lock_store_file(LOCK_FILE_NAME, exclusive);
+    if (fd >= 0 && exclusive) cdc_recover(fd); // before anything touches FILE_NAME
+    return fd;
+}
+
+// lock_store on the lock file at path; the replica applier uses it to lock
+// the standby copy from the primary's directory.
+int lock_store_file(const char *path, int exclusive)
+{
+    thread_lock_take();
+    int fd = open(path, O_RDWR | O_CREAT | O_BINARY, 0644);
+    if (fd < 0)
+    {
+        thread_lock_drop();
+        return -1;
+    }
+#ifdef _WIN32
+    OVERLAPPED ov = {0};
+    DWORD flags = exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0;
+    if (!LockFileEx((HANDLE)_get_osfhandle(fd), flags, 0, 1, 0, &ov))
+    {
+        close(fd);
+        thread_lock_drop();
+        return -1;
+    }
+#else
+    struct flock fl = {0};
+    fl.l_type = exclusive ? F_WRLCK : F_RDLCK;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &fl) == -1)
+    {
+        if (errno != EINTR)
+        {
+            close(fd);
+            thread_lock_drop();
+            return -1;
+        }
+    }
+#endif
+    return fd;
+}
+
+void unlock_store(int fd)
+{
+    if (fd < 0) return;
+#ifdef _WIN32
+    OVERLAPPED ov = {0};
+    UnlockFileEx((HANDLE)_get_osfhandle(fd), 0, 1, 0, &ov);
+#endif
+    close(fd); // closing the descriptor drops fcntl locks
+    thread_lock_drop();
+}
+
+int lock_word_get(int lk, int word, unsigned long long *out)
+{
+    return lseek(lk, (long)word * (long)sizeof(*out), SEEK_SET) >= 0 && read(lk, out, sizeof(*out)) == (int)sizeof(*out);
+}
+
+int lock_word_set(int lk, int word, unsigned long long value)
+{
+    return lseek(lk, (long)word * (long)sizeof(value), SEEK_SET) >= 0 &&
+           write(lk, &value, sizeof(value)) == (int)sizeof(value);
+}
+
+static unsigned long long read_generation(int fd)
+{
+    unsigned long long gen = 0;
+    if (!lock_word_get(fd, LOCK_WORD_GENERATION, &gen)) gen = 0;
+    return gen;
+}
+
+unsigned long long store_generation_locked(int lk)
+{
+    return read_generation(lk);
+}
+
+static unsigned long long bump_generation(int fd)
+{
+    unsigned long long gen = read_generation(fd) + 1;
+    return lock_word_set(fd, LOCK_WORD_GENERATION, gen) ? gen : 0;
+}
+
+// Cheap staleness check for callers holding a cached copy of the records.
+unsigned long long store_generation(void)
+{
+    int lk = lock_store(0);
+    if (lk < 0) return 0;
+    unsigned long long gen = read_generation(lk);
+    unlock_store(lk);
+    return gen;
+}
+
+/* ---------------- Crash injection ----------------
+ * Compiled in only with -DSMS_CRASH_POINTS, for bench/stress_store.c.
+ */
+
+#ifdef SMS_CRASH_POINTS
+const char *crash_point_armed = NULL;
+
+void store_crash_point(const char *name)
+{
+    if (crash_point_armed && strcmp(crash_point_armed, name) == 0) _exit(CRASH_EXIT_STATUS);
+}
+
+// Writes the first half of buf and exits, as a crash in mid-write would.
+void store_crash_torn(const char *name, int fd, const void *buf, size_t size)
+{
+    if (crash_point_armed && strcmp(crash_point_armed, name) == 0)
+    {
+        long half = (long)write(fd, buf, size / 2);
+        (void)half;
+        _exit(CRASH_EXIT_STATUS);
+    }
+}
+#endif
+
+/* ---------------- Roll index ----------------
+ * Every roll on file, in a RollMap, so insert_student rejects a duplicate
+ * in O(1) instead of rescanning the file. It is built from the file on the
+ * first insert, kept current by our own appends and saves, and rebuilt
+ * only when the generation shows another process wrote. Only touched with
+ * the store lock held.
+ */
+
+static struct
+{
+    RollMap map; // roll -> 0; only membership matters
+    unsigned long long generation;
+    int valid;
+} rolls;
+
+static int rolls_add(int roll)
+{
+    return rollmap_put(&rolls.map, roll, 0);
+}
+
+static int rolls_has(int roll)
+{
+    return rolls.map.keys && rollmap_find(&rolls.map, roll) >= 0;
+}
+
+// Empties the set, sized for about n rolls.
+static int rolls_reset(size_t n)
+{
+    rollmap_free(&rolls.map);
+    rolls.valid = 0;
+    return rollmap_init(&rolls.map, n);
+}
+
+static int rolls_build(const Student arr[], int n, unsigned long long generation)
+{
+    if (!rolls_reset((size_t)n)) return 0;
+    for (int i = 0; i < n; ++i)
+        if (!rolls_add(arr[i].roll)) return 0;
+    rolls.generation = generation;
+    rolls.valid = 1;
+    return 1;
+}
+
+// Rebuilds the set from the file unless it already matches. Caller holds lk.
+static int rolls_sync(int lk)
+{
+    unsigned long long gen = read_generation(lk);
+    if (rolls.valid && rolls.generation == gen) return 1;
+    FILE *fp = fopen(FILE_NAME, "rb");
+    struct stat st;
+    size_t n = fp && fstat(fileno(fp), &st) == 0 ? (size_t)st.st_size / sizeof(Student) : 0;
+    int ok = rolls_reset(n);
+    if (fp)
+    {
+        Student buf[256];
+        size_t got;
+        while (ok && (got = fread(buf, sizeof(Student), 256, fp)) > 0)
+            for (size_t i = 0; ok && i < got; ++i) ok = rolls_add(buf[i].roll);
+        fclose(fp);
+    }
+    if (!ok) return 0; // rolls.valid stays 0
+    rolls.generation = gen;
+    rolls.valid = 1;
+    return 1;
+}
+
+// Records an append that moved the file from generation gen - 1 to gen.
+static void rolls_note_append(int roll, unsigned long long gen)
+{
+    if (rolls.valid && gen && rolls.generation == gen - 1 && rolls_add(roll))
+        rolls.generation = gen;
+    else
+        rolls.valid = 0;
+}
+
+/* ---------------- File I/O ---------------- */
+
+int load_students(Student arr[])
+{
+    unsigned long long t0 = metrics_start();
+    int lk = lock_store(0);
+    if (lk >= 0) loaded_generation = read_generation(lk);
+    FILE *fp = fopen(FILE_NAME, "rb");
+    if (!fp)
+    {
+        unlock_store(lk);
+        return 0;
+    }
+#if !defined(_WIN32) && defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(fileno(fp), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    // One bulk read instead of a call per record; a trailing partial record
+    // is ignored as before.
+    int cnt = (int)fread(arr, sizeof(Student), MAX_STUDENTS, fp);
+    fclose(fp);
+    unlock_store(lk);
+    metrics_end(M_LOAD, t0, cnt * sizeof(Student));
+    return cnt;
+}
+
+// Whole file into a malloc'd array. Caller holds lock_store.
+Student *load_all_students_locked(int *n)
+{
+    *n = 0;
+    FILE *fp = fopen(FILE_NAME, "rb");
+    if (!fp) return NULL;
+    struct stat st;
+    Student *arr = NULL;
+    if (fstat(fileno(fp), &st) == 0 && st.st_size >= (off_t)sizeof(Student))
+    {
+        size_t want = (size_t)st.st_size / sizeof(Student);
+        arr = malloc(want * sizeof(Student));
+        if (arr && fread(arr, sizeof(Student), want, fp) != want)
+        {
+            free(arr); // a read error, not a short file: we hold the lock
+            arr = NULL;
+        }
+        if (arr) *n = (int)want;
+    }
+    fclose(fp);
+    return arr;
+}
+
+// Loads every record, without the MAX_STUDENTS cap, into a malloc'd array
+// the caller frees. Returns NULL (and *n = 0) if there is nothing to load.
+Student *load_all_students(int *n)
+{
+    unsigned long long t0 = metrics_start();
+    int lk = lock_store(0);
+    if (lk >= 0) loaded_generation = read_generation(lk);
+    Student *arr = load_all_students_locked(n);
+    unlock_store(lk);
+    metrics_end(M_LOAD, t0, (unsigned long long)*n * sizeof(Student));
+    return arr;
+}
+
+// Number of records on file, from its size.
+int count_students(void)
+{
+    struct stat st;
+    int lk = lock_store(0);
+    int n = stat(FILE_NAME, &st) == 0 ? (int)(st.st_size / sizeof(Student)) : 0;
+    unlock_store(lk);
+    return n;
+}
+
+// Rewrites the whole file atomically (temp file + rename). Returns STORE_OK,
+// STORE_ERROR, or STORE_CONFLICT if another process changed the file after
+// our load.
+int save_all_students(Student arr[], int n)
+{
+    unsigned long long t0 = metrics_start();
+    int lk = lock_store(1);
+    if (lk < 0)
+    {
+        fprintf(stderr, "Error: cannot lock %s\n", FILE_NAME);
+        return STORE_ERROR;
+    }
+    if (read_generation(lk) != loaded_generation)
+    {
+        unlock_store(lk);
+        return STORE_CONFLICT;
+    }
+    int nold;
+    Student *old = load_all_students_locked(&nold); // to derive the change events
+    FILE *fp = fopen(TMP_FILE_NAME, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "Error: cannot write to %s\n", FILE_NAME);
+        free(old);
+        unlock_store(lk);
+        return STORE_ERROR;
+    }
+    int ok = fwrite(arr, sizeof(Student), n, fp) == (size_t)n;
+    ok = fflush(fp) == 0 && ok;
+#ifndef _WIN32
+    ok = fsync(fileno(fp)) == 0 && ok;
+#endif
+    ok = fclose(fp) == 0 && ok;
+    CRASH_POINT("save:written");
+    // The generation moves before the file does: a crash in between costs
+    // other processes a needless reload, whereas the other way round would
+    // leave them trusting cached copies of a file that has changed.
+    unsigned long long gen = 0;
+    ok = ok && (gen = bump_generation(lk)) != 0;
+    CRASH_POINT("save:bumped");
+    // The change events go first, so a crash after the rename cannot lose
+    // them; cdc_end or the next lock_store(1) cuts them off if it fails.
+    ok = ok && cdc_begin(lk, old, nold, arr, n, gen, -1) >= 0;
+    CRASH_POINT("save:logged");
+#ifdef _WIN32
+    ok = ok && MoveFileExA(TMP_FILE_NAME, FILE_NAME, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(TMP_FILE_NAME, FILE_NAME) == 0;
+#endif
+    if (!ok)
+    {
+        fprintf(stderr, "Error: cannot write to %s\n", FILE_NAME);
+        cdc_end(lk, 0); // before the temp file goes, which would read as renamed
+        remove(TMP_FILE_NAME);
+        if (gen) loaded_generation = gen; // the file itself is unchanged
+        free(old);
+        unlock_store(lk);
+        return STORE_ERROR;
+    }
+    CRASH_POINT("save:renamed");
+    loaded_generation = gen;
+    if (!rolls_build(arr, n, gen)) rolls.valid = 0;
+    rank_note_save(old, nold, arr, n, gen);
+    cdc_end(lk, 1);
+    free(old);
+    unlock_store(lk);
+    metrics_end(M_SAVE, t0, (unsigned long long)n * sizeof(Student));
+    return STORE_OK;
+}
+
+// Copies from to a new file to, fsync'd, replacing to. Returns 1 on success.
+int copy_file(const char *from, const char *to)
+{
+    FILE *in = fopen(from, "rb");
+    if (!in) return 0;
+    FILE *out = fopen(to, "wb");
+    if (!out)
+    {
+        fclose(in);
+        return 0;
+    }
+    char buf[65536];
+    size_t got;
+    int ok = 1;
+    while (ok && (got = fread(buf, 1, sizeof(buf), in)) > 0) ok = fwrite(buf, 1, got, out) == got;
+    ok = !ferror(in) && fflush(out) == 0 && ok;
+#ifndef _WIN32
+    ok = fsync(fileno(out)) == 0 && ok;
+#endif
+    fclose(in);
+    ok = fclose(out) == 0 && ok;
+    if (!ok) remove(to);
+    return ok;
+}
+
+// Caller holds the exclusive lock.
+static int append_locked(int lk, const Student *s)
+{
+    unsigned long long gen = bump_generation(lk); // first, as in save_all_students
+    CRASH_POINT("append:bumped");
+    int fd = gen ? open(FILE_NAME, O_WRONLY | O_APPEND | O_CREAT | O_BINARY, 0644) : -1;
+    struct stat st;
+#ifndef _WIN32
+    // A snapshot may be a hard link to this file (see snapshot.c); append
+    // to a copy of our own instead, so the snapshot keeps its roster.
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_nlink > 1)
+    {
+        close(fd);
+        fd = copy_file(FILE_NAME, TMP_FILE_NAME) && rename(TMP_FILE_NAME, FILE_NAME) == 0
+             ? open(FILE_NAME, O_WRONLY | O_APPEND | O_BINARY) : -1;
+    }
+#endif
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error: cannot open file for writing\n");
+        return STORE_ERROR;
+    }
+    // Drop half a record left by a crashed append, or every record after
+    // it would be read out of step.
+    int ok = fstat(fd, &st) == 0;
+    if (ok && st.st_size % sizeof(Student) != 0)
+        ok = ftruncate(fd, st.st_size - st.st_size % sizeof(Student)) == 0 && fstat(fd, &st) == 0;
+    ok = ok && cdc_begin(lk, NULL, 0, s, 1, gen, (long long)st.st_size) >= 0; // events first, as in save_all_students
+    CRASH_TORN("append:torn", fd, s, sizeof(Student));
+    ok = ok && write(fd, s, sizeof(Student)) == (int)sizeof(Student);
+    close(fd);
+    CRASH_POINT("append:written");
+    if (!ok)
+    {
+        fprintf(stderr, "Error: cannot write to %s\n", FILE_NAME);
+        cdc_end(lk, 0);
+        return STORE_ERROR;
+    }
+    rolls_note_append(s->roll, gen);
+    rank_note_append(s, gen);
+    cdc_end(lk, 1);
+    return STORE_OK;
+}
+
+// Appends one record with a single O_APPEND write. No uniqueness check.
+int append_student(const Student *s)
+{
+    unsigned long long t0 = metrics_start();
+    int lk = lock_store(1);
+    if (lk < 0)
+    {
+        fprintf(stderr, "Error: cannot lock %s\n", FILE_NAME);
+        return STORE_ERROR;
+    }
+    int r = append_locked(lk, s);
+    unlock_store(lk);
+    if (r == STORE_OK) metrics_end(M_APPEND, t0, sizeof(Student));
+    return r;
+}
+
+// Appends s unless its roll is already on file. The check and the append
+// happen under one exclusive lock. Returns STORE_OK, STORE_DUPLICATE or
+// STORE_ERROR.
+int insert_student(const Student *s)
+{
+    unsigned long long t0 = metrics_start();
+    int lk = lock_store(1);
+    if (lk < 0)
+    {
+        fprintf(stderr, "Error: cannot lock %s\n", FILE_NAME);
+        return STORE_ERROR;
+    }
+    if (!rolls_sync(lk))
+    {
+        fprintf(stderr, "Error: out of memory indexing %s\n", FILE_NAME);
+        unlock_store(lk);
+        return STORE_ERROR;
+    }
+    if (rolls_has(s->roll))
+    {
+        unlock_store(lk);
+        return STORE_DUPLICATE;
+    }
+    int r = append_locked(lk, s);
+    unlock_store(lk);
+    if (r == STORE_OK) metrics_end(M_APPEND, t0, sizeof(Student));
+    return r;
+}
+
+// Hints the OS to read the file ahead and builds the roll index, so the
+// first load and the first insert find everything warm. Returns STORE_OK
+// or STORE_ERROR.
+int warm_store(void)
+{
+    int lk = lock_store(0);
+    if (lk < 0) return STORE_ERROR;
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+    int fd = open(FILE_NAME, O_RDONLY | O_BINARY);
+    if (fd >= 0)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        close(fd);
+    }
+#endif
+    int ok = rolls_sync(lk);
+    unlock_store(lk);
+    return ok ? STORE_OK : STORE_ERROR;
+}
+
+// Index of the first record with this roll, or -1.
+int find_by_roll(const Student arr[], int n, int roll)
+{
+    for (int i = 0; i < n; ++i)
+        if (arr[i].roll == roll) return i;
+    return -1;
+}
+
+/* Sorting helpers */
+int cmp_roll_asc(const void *a, const void *b)
+{
+    Student *A = (Student*)a;
+    Student *B = (Student*)b;
+    return (A->roll - B->roll);
+}
+int cmp_marks_desc(const void *a, const void *b)
+{
+    Student *A = (Student*)a;
+    Student *B = (Student*)b;
+    if (A->marks < B->marks) return 1;
+    if (A->marks > B->marks) return -1;
+    return 0;
+}
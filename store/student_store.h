@@ -0,0 +1,466 @@
+// student_store.h
+// Record store shared by the terminal and GTK front ends: the Student
+// record, file I/O and locking, grading policy, queries and statistics.
+// Build with the Makefile (libstudentstore.a) or compile store/*.c along
+// with either front end.
+
+#ifndef STUDENT_STORE_H
+#define STUDENT_STORE_H
+
+#include <stdio.h>
+
+#define FILE_NAME "student.txt"
+#define LOCK_FILE_NAME FILE_NAME ".lock"   // holds the generation counter
+#define TMP_FILE_NAME FILE_NAME ".tmp"
+#define REPLICA_FILE_NAME FILE_NAME ".replica" // present only in a standby copy
+#define MAX_STUDENTS 2000
+
+typedef struct
+{
+    int roll;
+    char name[50];
+    char section[10];
+    float marks;
+    char grade[6]; // e.g. "A+", "B"
+} Student;
+
+// Result codes of the mutating calls. STORE_OK is 1 and STORE_ERROR 0, so
+// a plain truth test still distinguishes success from failure.
+enum
+{
+    STORE_OK = 1,
+    STORE_ERROR = 0,
+    STORE_DUPLICATE = -1, // roll already exists
+    STORE_CONFLICT = -2,  // file changed by another process since our load
+    STORE_INVALID = -3    // record out of bounds (marks outside 0..100)
+};
+
+/* ---------------- Locking (store_io.c) ---------------- */
+
+// Generation seen by the last load_students on the calling thread; a
+// worker that saves on behalf of another thread must carry it across.
+extern _Thread_local unsigned long long loaded_generation;
+
+int lock_store(int exclusive);
+int lock_store_file(const char *path, int exclusive);
+void unlock_store(int fd);
+unsigned long long store_generation(void);
+unsigned long long store_generation_locked(int lk); // lk from lock_store
+
+// The lock file is a row of 8-byte words: the generation, then the change
+// stream's commit state (cdc.c). A word an older lock file lacks reads as
+// missing (0 returned).
+enum { LOCK_WORD_GENERATION, LOCK_WORD_CDC_COMMITTED, LOCK_WORD_CDC_INTENT };
+int lock_word_get(int lk, int word, unsigned long long *out);
+int lock_word_set(int lk, int word, unsigned long long value);
+
+/* ---------------- Crash injection (store_io.c) ---------------- */
+
+// Built with -DSMS_CRASH_POINTS (only the stress harness is), the write
+// paths name each step after which a crash would leave the files in a
+// different state; a process that sets crash_point_armed to one of those
+// names exits there with CRASH_EXIT_STATUS. Otherwise both compile away.
+#define CRASH_EXIT_STATUS 86
+#ifdef SMS_CRASH_POINTS
+extern const char *crash_point_armed;
+void store_crash_point(const char *name);
+void store_crash_torn(const char *name, int fd, const void *buf, size_t size);
+#define CRASH_POINT(name) store_crash_point(name)
+#define CRASH_TORN(name, fd, buf, size) store_crash_torn(name, fd, buf, size)
+#else
+#define CRASH_POINT(name) ((void)0)
+#define CRASH_TORN(name, fd, buf, size) ((void)0)
+#endif
+
+/* ---------------- Records (store_io.c) ---------------- */
+
+int load_students(Student arr[]);
+Student *load_all_students(int *n);
+Student *load_all_students_locked(int *n); // caller holds lock_store
+int count_students(void);
+int save_all_students(Student arr[], int n);
+int append_student(const Student *s);
+int insert_student(const Student *s);
+int find_by_roll(const Student arr[], int n, int roll);
+int warm_store(void); // read ahead and build the roll index before first use
+int copy_file(const char *from, const char *to);
+
+int cmp_roll_asc(const void *a, const void *b);
+int cmp_marks_desc(const void *a, const void *b);
+
+/* ---------------- Roll map (rollmap.c) ---------------- */
+
+typedef struct
+{
+    long long *keys;
+    int *vals;
+    size_t slots, used;
+} RollMap;
+
+int rollmap_init(RollMap *m, size_t capacity);
+int rollmap_find(const RollMap *m, int roll);
+int rollmap_put(RollMap *m, int roll, int idx);
+void rollmap_remove(RollMap *m, int roll);
+void rollmap_free(RollMap *m);
+
+/* ---------------- Transactions (txn.c) ---------------- */
+
+// Several inserts, updates and deletes applied as one: changes are made to
+// an in-memory copy taken at txn_begin and written with a single save at
+// txn_commit, which fails with STORE_CONFLICT if anyone wrote meanwhile.
+// txn_commit and txn_abort both end the transaction and free it.
+typedef struct Txn Txn;
+
+Txn *txn_begin(void); // NULL if out of memory or the roster cannot be read
+const Student *txn_find(Txn *t, int roll); // sees the transaction's own changes
+int txn_count(const Txn *t);
+int txn_insert(Txn *t, const Student *s);
+int txn_update(Txn *t, const Student *s);
+int txn_delete(Txn *t, int roll);
+int txn_commit(Txn *t);
+void txn_abort(Txn *t);
+
+/* ---------------- Change stream (cdc.c) ---------------- */
+
+#define CDC_FILE_NAME FILE_NAME ".cdc"
+
+enum { CDC_INSERT = 1, CDC_UPDATE, CDC_DELETE };
+
+typedef struct
+{
+    unsigned long long seq;        // 1, 2, 3, ... with no gaps
+    unsigned long long generation; // store generation the change produced
+    int op;                        // CDC_INSERT, CDC_UPDATE or CDC_DELETE
+    int pos;                       // index of the record in FILE_NAME as the change applies
+    Student rec;                   // new value; the removed record for CDC_DELETE
+} ChangeRecord;
+
+int cdc_read(unsigned long long from_seq, ChangeRecord out[], int max);
+unsigned long long cdc_last_seq(void);
+unsigned long long cdc_last_seq_locked(int lk); // lk from lock_store
+// Called by store_io.c with the exclusive lock held.
+int cdc_begin(int lk, const Student old[], int nold, const Student cur[], int ncur, unsigned long long generation,
+              long long append_at);
+int cdc_end(int lk, int committed);
+void cdc_recover(int lk);
+
+/* ---------------- Hot standby (replica.c) ---------------- */
+
+// A standby directory holds a copy of FILE_NAME kept current from the
+// change stream, plus REPLICA_FILE_NAME recording how far it has applied.
+// Front ends started there can read but not write until it is promoted.
+typedef struct
+{
+    unsigned long long applied_seq; // last change applied to the copy
+    unsigned long long primary_seq; // newest change on the primary
+    unsigned long long generation;  // generation of the last change applied
+    int applied;                    // changes applied by this call
+    int reseeded;                   // the copy was replaced by a full copy of the primary
+    int records;                    // records in the copy
+    double lag_seconds;             // commit-to-apply delay of the newest change, -1 if none applied
+} ReplicaStatus;
+
+int replica_sync(const char *dir, ReplicaStatus *st);
+int replica_promote(const char *dir);
+
+/* ---------------- Snapshots (snapshot.c) ---------------- */
+
+// Named read-only copies of the roster as it stood when taken. Taking one
+// links FILE_NAME rather than copying it, so it is O(1); see snapshot.c.
+#define SNAPSHOT_DIR "snapshots"
+#define SNAPSHOT_CATALOG SNAPSHOT_DIR "/catalog"
+#define SNAPSHOT_NAME_LEN 32
+#define MAX_SNAPSHOTS 1024
+
+typedef struct
+{
+    char name[SNAPSHOT_NAME_LEN];
+    long long taken;               // time_t
+    unsigned long long generation; // store generation it captured
+    int records;
+} Snapshot;
+
+int snapshot_create(const char *name, Snapshot *out); // NULL or "" names it by the time
+int snapshot_list(Snapshot out[], int max);
+int snapshot_as_of(long long when, Snapshot *out);
+Student *snapshot_load(const char *name, int *n);
+int snapshot_drop(const char *name);
+void snapshot_path(const char *name, char *out, int size);
+
+/* ---------------- Incremental backups (backup.c) ---------------- */
+
+// Backups of snapshots into a directory of their own (ideally another
+// disk) that store each distinct chunk of records once, so a backup writes
+// only what changed since the previous one.
+#ifndef BACKUP_CHUNK_AVG
+#define BACKUP_CHUNK_AVG 32 // records per chunk on average
+#endif
+#define MAX_BACKUPS 8760    // a year of hourly backups
+
+typedef struct
+{
+    char name[SNAPSHOT_NAME_LEN]; // of the snapshot backed up
+    long long taken;
+    unsigned long long generation;
+    int records, chunks;
+    int new_chunks;               // chunks this backup had to store
+    long long bytes_written;      // by this backup, manifest included
+} BackupInfo;
+
+int backup_snapshot(const char *dir, const char *name, BackupInfo *out);
+int backup_list(const char *dir, BackupInfo out[], int max);
+Student *backup_load(const char *dir, const char *name, int *n);
+
+/* ---------------- Paged reader (pager.c) ---------------- */
+
+// Reads records on demand in pages of PAGE_RECORDS, keeping the most
+// recently used pages in a fixed-size cache, so the first rows of a huge
+// roster show up without loading the rest and memory stays bounded.
+#define PAGE_RECORDS 64
+#ifndef PAGE_CACHE_PAGES
+#define PAGE_CACHE_PAGES 16
+#endif
+
+typedef struct PagedReader PagedReader;
+
+PagedReader *pager_open(int cache_pages); // 0 means PAGE_CACHE_PAGES
+int pager_count(const PagedReader *pr);
+unsigned long long pager_generation(const PagedReader *pr);
+const Student *pager_get(PagedReader *pr, int index);
+void pager_close(PagedReader *pr);
+
+/* ---------------- Arenas (arena.c) ---------------- */
+
+// Per-operation bump allocator: allocate freely, release everything with
+// one arena_free. size is the capacity of the first block.
+typedef struct Arena Arena;
+
+Arena *arena_new(size_t size);
+void *arena_alloc(Arena *a, size_t size);
+void arena_reset(Arena *a);
+void arena_free(Arena *a);
+
+/* ---------------- Grades (grades.c) ---------------- */
+
+#define GRADE_CONFIG_FILE "grades.cfg"
+#ifndef GRADE_BOUNDS
+#define GRADE_BOUNDS { 90, 80, 70, 60, 50 }
+#endif
+
+enum { GRADE_A_PLUS, GRADE_A, GRADE_B_PLUS, GRADE_B, GRADE_C, GRADE_F, GRADE_COUNT };
+
+extern const char *grade_names[GRADE_COUNT];
+extern int grade_bounds[GRADE_F];
+
+void build_grade_table(void);
+void load_grade_policy(void);
+int grade_of_marks(float marks);
+int grade_code(const char *g);
+void calc_grade_from_marks(Student *s);
+void regrade_all(Student arr[], int n);
+int apply_curve(Student arr[], int n, const char *section, float factor, float offset);
+
+/* ---------------- Queries (query.c) ---------------- */
+
+#define MAX_PREDICATES 8
+
+enum { F_ROLL, F_NAME, F_SECTION, F_MARKS, F_GRADE, F_NONE };
+enum { OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE };
+
+typedef struct
+{
+    int field;
+    int op;
+    double num;     // roll / marks operand
+    char str[50];   // name / section / grade operand
+} Predicate;
+
+typedef struct
+{
+    Predicate preds[MAX_PREDICATES];
+    int npreds;
+    int order_field; // F_NONE keeps file order
+    int order_desc;
+    int limit;       // 0 means no limit
+} Query;
+
+int compile_query(const char *text, Query *q, char *err, int errsize);
+int run_query(Student arr[], int n, const Query *q);
+int query_match(const Student *s, const Query *q);
+int query_key(const Query *q, char *out, int size);
+
+/* ---------------- Archived terms (partition.c) ---------------- */
+
+// FILE_NAME is the current term; past terms are read-only archives in
+// ARCHIVE_DIR, described by one catalog line each.
+#define ARCHIVE_DIR "archive"
+#define CATALOG_FILE ARCHIVE_DIR "/catalog"
+#define MAX_PARTITIONS 256
+#define PARTITION_NAME_LEN 32
+
+typedef struct
+{
+    char name[PARTITION_NAME_LEN];
+    int count;
+    int roll_min, roll_max;
+    float marks_min, marks_max;
+    unsigned long long section_mask; // one hashed bit per section present
+} Partition;
+
+unsigned long long section_bit(const char *section);
+int load_catalog(Partition out[], int max);
+int archive_term(const char *name);
+int partition_may_match(const Partition *p, const Query *q);
+Student *query_all_terms(const Query *q, int *n, int *pruned);
+
+/* ---------------- Archive files (archive.c) ---------------- */
+
+// Archived terms are stored as ARCHIVE_DIR/<name>.sma: columnar blocks of
+// ARCHIVE_BLOCK_RECORDS, deflated, with a block index of roll/marks ranges.
+#define ARCHIVE_BLOCK_RECORDS 4096
+#ifndef ARCHIVE_LEVEL
+#define ARCHIVE_LEVEL 1 // zlib level: 1 favours speed, 9 size
+#endif
+
+typedef struct ArchiveReader ArchiveReader;
+
+int archive_write(const char *path, const Student arr[], int n, int level);
+ArchiveReader *archive_open(const char *path);
+int archive_count(const ArchiveReader *a);
+int archive_blocks_read(const ArchiveReader *a);
+int archive_query(ArchiveReader *a, const Query *q, Student **out, int *n, int *cap);
+void archive_close(ArchiveReader *a);
+
+/* ---------------- Statistics (stats.c) ---------------- */
+
+#define HIST_BUCKETS 10001
+
+typedef struct
+{
+    int count[HIST_BUCKETS];
+    int cum[HIST_BUCKETS + 1]; // cum[b] = number of marks in buckets below b
+    int n;
+    double sum, sumsq;
+    int dirty;
+} MarksHistogram;
+
+int hist_bucket(float marks);
+void hist_add(MarksHistogram *h, float marks);
+void hist_remove(MarksHistogram *h, float marks);
+void hist_build(MarksHistogram *h, const Student arr[], int n);
+float hist_kth(MarksHistogram *h, int k);
+float hist_median(MarksHistogram *h);
+float hist_percentile(MarksHistogram *h, float p);
+int hist_rank(MarksHistogram *h, float marks);
+double hist_stddev(const MarksHistogram *h);
+
+// Rank lookups served from an index kept current by our own writes; see
+// stats.c.
+typedef struct
+{
+    Student rec;
+    int rank;  // 1 for the highest marks; equal marks share a rank
+    int n;     // records ranked
+    int below; // records with lower marks
+} RankInfo;
+
+int rank_of_roll(int roll, RankInfo *out);
+void rank_note_append(const Student *s, unsigned long long gen);
+void rank_note_save(const Student old[], int nold, const Student cur[], int ncur, unsigned long long gen);
+
+#define MAX_SECTIONS 2048
+
+typedef struct
+{
+    char section[10];
+    int count;
+    float total, min, max;
+    int grade_counts[GRADE_COUNT];
+} SectionStats;
+
+int group_by_section(const Student arr[], int n, SectionStats out[]);
+
+typedef struct
+{
+    int n;
+    float total, max, min;
+    float median, p10, p25, p75, p90;
+    double stddev;
+    int grade_counts[GRADE_COUNT];
+    int ngroups;
+    SectionStats groups[MAX_SECTIONS]; // only the first ngroups are set
+} StatsReport;
+
+size_t stats_report(const Student arr[], int n, StatsReport *r);
+
+/* ---------------- Result cache (cache.c) ---------------- */
+
+// Reports and query results keyed by a normalized key and tagged with the
+// generation they were computed at; see cache.c. Usage:
+//     long got = cache_get(key, store_generation(), buf, sizeof(buf));
+//     if (got < 0) { load, compute, cache_put(key, loaded_generation, buf, size); }
+#ifndef CACHE_MAX_BYTES
+#define CACHE_MAX_BYTES (16 << 20)
+#endif
+#define CACHE_KEY_LEN 256
+
+// Keys of the fixed reports; queries use query_key.
+#define CACHE_SORT_ROLL "sort roll asc"
+#define CACHE_SORT_MARKS "sort marks desc" // top-N reads a prefix of it
+#define CACHE_STATISTICS "statistics"
+
+typedef struct
+{
+    unsigned long long hits, misses, evictions;
+    size_t bytes;
+    int entries;
+} CacheStats;
+
+long cache_get(const char *key, unsigned long long generation, void *out, size_t cap);
+void cache_put(const char *key, unsigned long long generation, const void *data, size_t size);
+void cache_clear(void);
+void cache_stats(CacheStats *out);
+
+/* ---------------- Metrics (metrics.c) ---------------- */
+
+enum
+{
+    M_LOAD, M_SAVE, M_APPEND, M_QUERY, M_SORT, M_TOP_N, M_STATS, M_LIST_POPULATE,
+    M_FIRST_QUERY, // launch to first answered request (GUI)
+    M_REPLICA_LAG, // commit on the primary to apply on a standby
+    M_RANK,
+    M_COUNT
+};
+
+#define METRIC_BUCKETS 256
+
+typedef struct
+{
+    unsigned long long count, total_ns, bytes;
+    unsigned long long buckets[METRIC_BUCKETS]; // latency histogram, see metrics.c
+} OpMetric;
+
+extern int metrics_enabled;
+
+// Time an operation with:
+//     unsigned long long t0 = metrics_start();
+//     ...
+//     metrics_end(M_SORT, t0, bytes);
+// Both are no-ops when metrics are disabled, and compile away entirely
+// with -DSMS_NO_METRICS.
+// metrics_record adds a duration measured some other way.
+#ifdef SMS_NO_METRICS
+#define metrics_start() 0ULL
+#define metrics_end(op, start, bytes) ((void)(start))
+#define metrics_record(op, ns, bytes) ((void)0)
+#else
+unsigned long long metrics_start(void);
+void metrics_end(int op, unsigned long long start, unsigned long long bytes);
+void metrics_record(int op, unsigned long long ns, unsigned long long bytes);
+#endif
+void metrics_init(void);
+void metrics_snapshot(OpMetric out[]);
+void metrics_print(FILE *fp);
+int metrics_write_prometheus(const char *path);
+
+#endif
@@ -0,0 +1,181 @@
+// txn.c
+// Multi-record transactions.
+//
+// txn_begin loads the roster once and every later call edits that copy in
+// memory, found by roll through a RollMap, so a transaction touching k
+// records costs one load, k hash lookups and one save however large k is.
+// Deletes only mark the record; txn_commit drops them (keeping the order
+// of the rest, as a delete that shifts the array does), checks the records
+// the transaction touched and writes everything with one
+// save_all_students: one fsync'd rename and one batch of change events.
+// The save is refused with STORE_CONFLICT if the file changed after
+// txn_begin, so a transaction never overwrites someone else's work.
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "student_store.h"
+
+enum { REC_DEAD = 1, REC_TOUCHED = 2 };
+
+struct Txn
+{
+    Student *recs;
+    unsigned char *flags; // REC_DEAD, REC_TOUCHED
+    int n, cap, live;
+    RollMap index; // roll -> first live record
+    int has_dups;  // a roll occurs twice on file, so a delete must rescan
+    int changes;
+    unsigned long long generation; // of the roster txn_begin loaded
+};
+
+static int reserve(Txn *t, int more)
+{
+    if (t->n + more <= t->cap) return 1;
+    int cap = t->cap ? t->cap : 64;
+    while (cap < t->n + more) cap *= 2;
+    Student *recs = realloc(t->recs, sizeof(Student) * cap);
+    if (!recs) return 0;
+    t->recs = recs;
+    unsigned char *flags = realloc(t->flags, cap);
+    if (!flags) return 0;
+    t->flags = flags;
+    t->cap = cap;
+    return 1;
+}
+
+// Whether FILE_NAME holds no records, so that loading it yielding nothing
+// means an empty roster rather than one that could not be read.
+static int roster_empty(void)
+{
+    struct stat st;
+    if (stat(FILE_NAME, &st) != 0) return errno == ENOENT;
+    return st.st_size < (off_t)sizeof(Student);
+}
+
+// Starts a transaction on the current roster. Returns NULL when out of
+// memory or the roster cannot be read, so a commit never replaces a roster
+// it did not load.
+Txn *txn_begin(void)
+{
+    Txn *t = calloc(1, sizeof(Txn));
+    if (!t) return NULL;
+    t->recs = load_all_students(&t->n);
+    if (!t->recs && !roster_empty())
+    {
+        free(t);
+        return NULL;
+    }
+    t->generation = loaded_generation;
+    t->cap = t->n;
+    t->live = t->n;
+    t->flags = calloc(t->n > 0 ? t->n : 1, 1);
+    int ok = t->flags && rollmap_init(&t->index, t->n);
+    for (int i = 0; ok && i < t->n; ++i)
+    {
+        if (rollmap_find(&t->index, t->recs[i].roll) >= 0) t->has_dups = 1; // first match wins, as in find_by_roll
+        else ok = rollmap_put(&t->index, t->recs[i].roll, i);
+    }
+    if (!ok)
+    {
+        txn_abort(t);
+        return NULL;
+    }
+    return t;
+}
+
+// The record with roll as the transaction sees it, or NULL. The pointer is
+// valid until the next call on t.
+const Student *txn_find(Txn *t, int roll)
+{
+    int i = rollmap_find(&t->index, roll);
+    return i < 0 ? NULL : &t->recs[i];
+}
+
+int txn_count(const Txn *t)
+{
+    return t->live;
+}
+
+// Returns STORE_OK, STORE_DUPLICATE or STORE_ERROR (out of memory).
+int txn_insert(Txn *t, const Student *s)
+{
+    if (rollmap_find(&t->index, s->roll) >= 0) return STORE_DUPLICATE;
+    if (!reserve(t, 1) || !rollmap_put(&t->index, s->roll, t->n)) return STORE_ERROR;
+    t->recs[t->n] = *s;
+    t->flags[t->n++] = REC_TOUCHED;
+    t->live++;
+    t->changes++;
+    return STORE_OK;
+}
+
+// Replaces the record with s->roll. Returns STORE_OK, or STORE_ERROR if
+// there is none.
+int txn_update(Txn *t, const Student *s)
+{
+    int i = rollmap_find(&t->index, s->roll);
+    if (i < 0) return STORE_ERROR;
+    t->recs[i] = *s;
+    t->flags[i] |= REC_TOUCHED;
+    t->changes++;
+    return STORE_OK;
+}
+
+// Removes the record with roll. Returns STORE_OK, or STORE_ERROR if there
+// is none.
+int txn_delete(Txn *t, int roll)
+{
+    int i = rollmap_find(&t->index, roll);
+    if (i < 0) return STORE_ERROR;
+    t->flags[i] = REC_DEAD;
+    rollmap_remove(&t->index, roll);
+    for (int j = i + 1; t->has_dups && j < t->n; ++j)
+        if (!(t->flags[j] & REC_DEAD) && t->recs[j].roll == roll)
+        {
+            if (!rollmap_put(&t->index, roll, j)) return STORE_ERROR;
+            break;
+        }
+    t->live--;
+    t->changes++;
+    return STORE_OK;
+}
+
+static int in_bounds(const Student *s)
+{
+    return !isnan(s->marks) && s->marks >= 0 && s->marks <= 100 &&
+           memchr(s->name, '\0', sizeof(s->name)) && memchr(s->section, '\0', sizeof(s->section)) &&
+           memchr(s->grade, '\0', sizeof(s->grade));
+}
+
+// Checks and writes every change, then frees t. Returns STORE_OK,
+// STORE_INVALID (a touched record is out of bounds; nothing is written),
+// STORE_CONFLICT or STORE_ERROR.
+int txn_commit(Txn *t)
+{
+    int r = STORE_OK;
+    for (int i = 0; r == STORE_OK && i < t->n; ++i)
+        if (t->flags[i] == REC_TOUCHED && !in_bounds(&t->recs[i])) r = STORE_INVALID;
+    if (r == STORE_OK && t->changes > 0)
+    {
+        int m = 0;
+        for (int i = 0; i < t->n; ++i)
+            if (!(t->flags[i] & REC_DEAD)) t->recs[m++] = t->recs[i];
+        loaded_generation = t->generation;
+        r = save_all_students(t->recs, m);
+    }
+    txn_abort(t);
+    return r;
+}
+
+// Discards every change and frees t.
+void txn_abort(Txn *t)
+{
+    if (!t) return;
+    free(t->recs);
+    free(t->flags);
+    rollmap_free(&t->index);
+    free(t);
+}
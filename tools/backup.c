@@ -0,0 +1,138 @@
+// backup.c
+// Takes a snapshot of the roster and backs it up incrementally, lists the
+// backups in a directory, and restores one. See store/snapshot.c and
+// store/backup.c.
+// Build and run (from the directory that holds student.txt):
+//   make backup
+//   ./backup --dir /mnt/backup/sms                  snapshot now, back it up
+//   ./backup --dir /mnt/backup/sms --snapshot NAME  back up an existing snapshot
+//   ./backup --dir /mnt/backup/sms --list           list the backups there
+//   ./backup --dir /mnt/backup/sms --restore NAME   make backup NAME the roster
+//
+// Run it hourly (cron, Task Scheduler): each run writes the chunks changed
+// since the previous backup and a small manifest. Local snapshots beyond
+// the newest --keep (default 24) are dropped after a successful backup;
+// the backups themselves are kept.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../store/student_store.h"
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s --dir DIR [--snapshot NAME | --list | --restore NAME] [--keep N]\n", prog);
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void print_time(long long t)
+{
+    char buf[32];
+    time_t tt = (time_t)t;
+    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime(&tt));
+    printf("%s", buf);
+}
+
+static int list_backups(const char *dir)
+{
+    static BackupInfo all[MAX_BACKUPS];
+    int n = backup_list(dir, all, MAX_BACKUPS);
+    printf("%-24s %-19s %9s %8s %8s %12s\n", "backup", "taken", "records", "chunks", "new", "bytes");
+    for (int i = 0; i < n; ++i)
+    {
+        printf("%-24s ", all[i].name);
+        print_time(all[i].taken);
+        printf(" %9d %8d %8d %12lld\n", all[i].records, all[i].chunks, all[i].new_chunks, all[i].bytes_written);
+    }
+    return 0;
+}
+
+static int restore(const char *dir, const char *name)
+{
+    int n, cur;
+    Student *arr = backup_load(dir, name, &n);
+    if (!arr)
+    {
+        fprintf(stderr, "Cannot read backup %s in %s\n", name, dir);
+        return 1;
+    }
+    free(load_all_students(&cur)); // for the generation save_all_students checks
+    int r = save_all_students(arr, n);
+    free(arr);
+    if (r != STORE_OK)
+    {
+        fprintf(stderr, "Restore failed%s\n", r == STORE_CONFLICT ? ": the roster changed meanwhile" : "");
+        return 1;
+    }
+    printf("Restored %s: %d records (was %d)\n", name, n, cur);
+    return 0;
+}
+
+// Drops the oldest local snapshots so that at most keep remain.
+static void prune_snapshots(int keep)
+{
+    static Snapshot all[MAX_SNAPSHOTS];
+    int n = snapshot_list(all, MAX_SNAPSHOTS);
+    for (int i = 0; i < n - keep; ++i) snapshot_drop(all[i].name);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dir = NULL, *name = NULL, *restore_name = NULL;
+    int list = 0, keep = 24;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) dir = argv[++i];
+        else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) name = argv[++i];
+        else if (strcmp(argv[i], "--restore") == 0 && i + 1 < argc) restore_name = argv[++i];
+        else if (strcmp(argv[i], "--list") == 0) list = 1;
+        else if (strcmp(argv[i], "--keep") == 0 && i + 1 < argc) keep = atoi(argv[++i]);
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!dir || (list + (name != NULL) + (restore_name != NULL)) > 1 || keep < 1)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (list) return list_backups(dir);
+    if (restore_name) return restore(dir, restore_name);
+
+    double t0 = now_ms();
+    Snapshot snap;
+    if (!name)
+    {
+        int r = snapshot_create(NULL, &snap);
+        if (r != STORE_OK)
+        {
+            fprintf(stderr, "Cannot take a snapshot%s\n", r == STORE_DUPLICATE ? ": one was taken this second" : "");
+            return 1;
+        }
+        name = snap.name;
+    }
+    double t1 = now_ms();
+    BackupInfo b;
+    int r = backup_snapshot(dir, name, &b);
+    if (r != STORE_OK)
+    {
+        fprintf(stderr, "Cannot back up snapshot %s%s\n", name, r == STORE_DUPLICATE ? ": already backed up" : "");
+        return 1;
+    }
+    double t2 = now_ms();
+    printf("Backed up %s: %d records in %d chunks, %d new, %lld bytes written (snapshot %.1f ms, backup %.1f ms)\n",
+           b.name, b.records, b.chunks, b.new_chunks, b.bytes_written, t1 - t0, t2 - t1);
+    prune_snapshots(keep);
+    return 0;
+}
@@ -0,0 +1,114 @@
+// cdc_tail.c
+// Prints the change stream of student.txt (see store/cdc.c), one change
+// per line, for downstream sync jobs and for inspection.
+// Build and run (from the directory that holds student.txt):
+//   make cdc_tail
+//   ./cdc_tail                        every change so far
+//   ./cdc_tail --from 120             changes from sequence number 120 on
+//   ./cdc_tail --offset-file sync.pos resume after the last seq recorded in
+//                                     sync.pos and update it as we go
+//   ./cdc_tail --follow               keep polling for new changes
+//
+// Output is tab-separated: seq, generation, op, roll, name, section,
+// marks, grade. For deletes the fields are those of the removed record.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_seconds(s) Sleep((s) * 1000)
+#else
+#include <unistd.h>
+#define sleep_seconds(s) sleep(s)
+#endif
+
+#include "../store/student_store.h"
+
+#define BATCH 256
+
+static const char *op_names[] = { "?", "insert", "update", "delete" };
+
+static unsigned long long read_offset(const char *path)
+{
+    unsigned long long seq = 0;
+    FILE *fp = fopen(path, "r");
+    if (fp)
+    {
+        if (fscanf(fp, "%llu", &seq) != 1) seq = 0;
+        fclose(fp);
+    }
+    return seq;
+}
+
+// Replaces the offset file atomically so a crash never leaves it torn.
+static int write_offset(const char *path, unsigned long long seq)
+{
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return 0;
+    fprintf(fp, "%llu\n", seq);
+    if (fclose(fp) != 0) return 0;
+#ifdef _WIN32
+    return MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(tmp, path) == 0;
+#endif
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [--from SEQ] [--offset-file PATH] [--follow] [--interval SECONDS]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long long next = 1;
+    const char *offset_file = NULL;
+    int follow = 0, interval = 2;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) next = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--offset-file") == 0 && i + 1 < argc) offset_file = argv[++i];
+        else if (strcmp(argv[i], "--follow") == 0) follow = 1;
+        else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) interval = atoi(argv[++i]);
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (offset_file) next = read_offset(offset_file) + 1;
+    if (interval < 1) interval = 1;
+
+    static ChangeRecord batch[BATCH];
+    for (;;)
+    {
+        int n = cdc_read(next, batch, BATCH);
+        for (int k = 0; k < n; ++k)
+        {
+            const ChangeRecord *c = &batch[k];
+            const Student *s = &c->rec;
+            printf("%llu\t%llu\t%s\t%d\t%.*s\t%.*s\t%.2f\t%.*s\n", c->seq, c->generation,
+                   op_names[c->op >= CDC_INSERT && c->op <= CDC_DELETE ? c->op : 0], s->roll,
+                   (int)sizeof(s->name), s->name, (int)sizeof(s->section), s->section,
+                   s->marks, (int)sizeof(s->grade), s->grade);
+        }
+        if (n > 0)
+        {
+            next += n;
+            fflush(stdout);
+            if (offset_file && !write_offset(offset_file, next - 1))
+            {
+                fprintf(stderr, "Error: cannot write %s\n", offset_file);
+                return 1;
+            }
+            continue; // drain full batches before sleeping
+        }
+        if (!follow) break;
+        sleep_seconds(interval);
+    }
+    return 0;
+}
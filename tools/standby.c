@@ -0,0 +1,90 @@
+// standby.c
+// Keeps a hot-standby copy of student.txt in another directory (ideally on
+// another disk) by shipping the change stream, and promotes it on demand.
+// See store/replica.c.
+// Build and run (from the directory that holds student.txt):
+//   make standby
+//   ./standby --dir /mnt/backup/sms            apply what is new, once
+//   ./standby --dir /mnt/backup/sms --follow   keep applying as changes land
+//   ./standby --dir /mnt/backup/sms --promote  catch up if the primary is
+//                                              still readable, then make the
+//                                              copy writable
+//
+// Front ends started in the standby directory serve read-only requests, so
+// reports can run there without taking locks on the primary. Each sync
+// prints the position, records and lag; with SMS_METRICS_PROM=path the lag
+// histogram (replica_lag) is also written there after every sync.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_seconds(s) Sleep((s) * 1000)
+#else
+#include <unistd.h>
+#define sleep_seconds(s) sleep(s)
+#endif
+
+#include "../store/student_store.h"
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s --dir DIR [--follow] [--interval SECONDS] [--promote]\n", prog);
+}
+
+static void report(const ReplicaStatus *st)
+{
+    printf("applied %llu of %llu (%d new), generation %llu, %d records",
+           st->applied_seq, st->primary_seq, st->applied, st->generation, st->records);
+    if (st->reseeded) printf(", reseeded from the primary");
+    if (st->lag_seconds >= 0) printf(", lag %.3f s", st->lag_seconds);
+    printf("\n");
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dir = NULL;
+    int follow = 0, promote = 0, interval = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) dir = argv[++i];
+        else if (strcmp(argv[i], "--follow") == 0) follow = 1;
+        else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) interval = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--promote") == 0) promote = 1;
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!dir || (follow && promote))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (interval < 1) interval = 1;
+    metrics_init();
+    const char *prom = getenv("SMS_METRICS_PROM");
+
+    ReplicaStatus st;
+    for (;;)
+    {
+        int r = replica_sync(dir, &st);
+        if (r == STORE_OK && (st.applied || st.reseeded || !follow)) report(&st);
+        if (r == STORE_OK && st.applied && prom && *prom) metrics_write_prometheus(prom);
+        if (promote)
+        {
+            if (r != STORE_OK) fprintf(stderr, "Warning: promoting without the latest changes\n");
+            if (replica_promote(dir) != STORE_OK) return 1;
+            printf("%s is now a primary\n", dir);
+            return 0;
+        }
+        if (r != STORE_OK) return 1;
+        if (!follow) break;
+        sleep_seconds(interval);
+    }
+    return 0;
+}